@@ -12,9 +12,11 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "AsteroidField.h"
 
+#include "Random.h"
 #include "SpriteSet.h"
 #include "System.h"
 
+#include <QHash>
 #include <QPainter>
 #include <QString>
 
@@ -30,15 +32,21 @@ void AsteroidField::Set(const System *system)
     if(!system)
         return;
 
+    // The asteroids are just decoration, so rather than using up one of the
+    // operation streams, base their positions on the system's name. That way
+    // a system's asteroids look the same every time it is selected.
+    Random random(qHash(system->Name()));
     for(const System::Asteroid &it : system->Asteroids())
     {
         QPixmap sprite = SpriteSet::Get("asteroid/" + it.type + "/spin-00");
         for(int i = 0; i < it.count; ++i)
         {
-            double angle = (rand() % 6283) * .001;
-            double velocity = (rand() % 1000) * (.001 * it.energy);
+            double angle = random.Int(6283) * .001;
+            double velocity = random.Int(1000) * (.001 * it.energy);
+            double x = random.Int(4096) - 2048;
+            double y = random.Int(4096) - 2048;
             asteroids.push_back({
-                QVector2D(rand() % 4096 - 2048, rand() % 4096 - 2048),
+                QVector2D(x, y),
                 QVector2D(velocity * sin(angle), velocity * cos(angle)),
                 sprite});
         }
@@ -0,0 +1,104 @@
+/* BatchGenerator.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "BatchGenerator.h"
+
+#include "Map.h"
+#include "Random.h"
+#include "StellarObject.h"
+#include "System.h"
+
+#include <QFutureWatcher>
+#include <QProgressDialog>
+#include <QtConcurrent>
+
+using namespace std;
+
+namespace {
+    struct Job {
+        System *target;
+        System result;
+        Random random;
+    };
+}
+
+
+
+bool BatchGenerator::Filter::Matches(const System &system) const
+{
+    if(!only.empty() && !only.count(&system))
+        return false;
+    if(!government.isEmpty() && system.Government() != government)
+        return false;
+    if(uninhabitedOnly)
+        for(const StellarObject *object : system.Objects())
+            if(object->IsInhabited() || !object->GetPlanet().isEmpty())
+                return false;
+    return true;
+}
+
+
+
+// Get every system in the map that matches the given filter.
+vector<System *> BatchGenerator::Select(Map &map, const Filter &filter)
+{
+    vector<System *> systems;
+    for(auto &it : map.Systems())
+        if(filter.Matches(it.second))
+            systems.push_back(&it.second);
+    return systems;
+}
+
+
+
+// Regenerate the given systems, showing a progress dialog that allows the
+// operation to be cancelled. Returns false if it was cancelled, in which
+// case none of the systems were changed.
+bool BatchGenerator::Run(const vector<System *> &systems, const Options &options, QWidget *parent)
+{
+    // Hand out the random number streams in order before starting, so that the
+    // results do not depend on which thread generates which system.
+    Random random = Random::Operation();
+    vector<Job> jobs;
+    jobs.reserve(systems.size());
+    for(System *system : systems)
+        jobs.push_back({system, *system, random.Split()});
+
+    QProgressDialog progress("Regenerating " + QString::number(jobs.size()) + " systems...",
+        "Cancel", 0, static_cast<int>(jobs.size()), parent);
+    progress.setWindowModality(Qt::WindowModal);
+
+    QFutureWatcher<void> watcher;
+    QObject::connect(&watcher, SIGNAL(finished()), &progress, SLOT(reset()));
+    QObject::connect(&progress, SIGNAL(canceled()), &watcher, SLOT(cancel()));
+    QObject::connect(&watcher, SIGNAL(progressRangeChanged(int,int)), &progress, SLOT(setRange(int,int)));
+    QObject::connect(&watcher, SIGNAL(progressValueChanged(int)), &progress, SLOT(setValue(int)));
+
+    watcher.setFuture(QtConcurrent::map(jobs, [options](Job &job)
+    {
+        if(options.layout)
+            job.result.Randomize(options.allowHabitable, options.requireHabitable, job.random);
+        if(options.asteroids)
+            job.result.ChangeAsteroids(job.random);
+        // The minables are based on the asteroids, so they must come second.
+        if(options.minables)
+            job.result.ChangeMinables(job.random);
+    }));
+    progress.exec();
+    watcher.waitForFinished();
+    if(watcher.isCanceled())
+        return false;
+
+    for(Job &job : jobs)
+        *job.target = job.result;
+    return true;
+}
@@ -0,0 +1,66 @@
+/* BatchGenerator.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef BATCHGENERATOR_H
+#define BATCHGENERATOR_H
+
+#include <QString>
+
+#include <set>
+#include <vector>
+
+class Map;
+class System;
+
+class QWidget;
+
+
+
+// Class for regenerating the stellar objects, asteroids, and minables of many
+// systems at once. Each system is generated on a copy, in parallel, with its
+// own random number stream; if the whole batch finishes, the copies replace
+// the originals all at once, and if it is cancelled nothing is changed.
+class BatchGenerator {
+public:
+    // Which systems to regenerate.
+    struct Filter {
+        // If not empty, only systems belonging to this government.
+        QString government;
+        // Only systems with no inhabited objects and no defined planets.
+        bool uninhabitedOnly = true;
+        // If not empty, only systems in this set.
+        std::set<const System *> only;
+
+        bool Matches(const System &system) const;
+    };
+    // What to regenerate in each system.
+    struct Options {
+        bool layout = true;
+        bool allowHabitable = true;
+        bool requireHabitable = false;
+        bool asteroids = true;
+        bool minables = true;
+    };
+
+
+public:
+    // Get every system in the map that matches the given filter.
+    static std::vector<System *> Select(Map &map, const Filter &filter);
+    // Regenerate the given systems, showing a progress dialog that allows the
+    // operation to be cancelled. Returns false if it was cancelled, in which
+    // case none of the systems were changed.
+    static bool Run(const std::vector<System *> &systems, const Options &options, QWidget *parent);
+};
+
+
+
+#endif // BATCHGENERATOR_H
@@ -0,0 +1,324 @@
+/* CommodityRandomizer.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "CommodityRandomizer.h"
+
+#include "LinkGraph.h"
+#include "PriceSmoother.h"
+#include "Random.h"
+#include "System.h"
+
+#include <QThread>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <map>
+
+using namespace std;
+
+namespace {
+    // Commodity parameters.
+    static const map<QString, int> BASE = {
+        {"Clothing", 140},
+        {"Electronics", 590},
+        {"Equipment", 330},
+        {"Food", 100},
+        {"Heavy Metals", 610},
+        {"Industrial", 520},
+        {"Luxury Goods", 920},
+        {"Medical", 430},
+        {"Metal", 190},
+        {"Plastic", 240}
+    };
+    static const map<QString, vector<int>> BINS = {
+        {"Clothing", {20, 60, 20}},
+        {"Electronics", {30, 40, 30}},
+        {"Equipment", {30, 20, 20, 30}},
+        {"Food", {24, 18, 16, 18, 24}},
+        {"Heavy Metals", {8, 12, 20, 20, 20, 12, 8}},
+        {"Industrial", {20, 30, 30, 20}},
+        {"Luxury Goods", {25, 20, 15, 10, 10, 20}},
+        {"Medical", {20, 20, 20, 20, 20}},
+        {"Metal", {30, 25, 20, 25}},
+        {"Plastic", {40, 20, 40}}
+    };
+
+
+    // Class holding the working space for assigning systems to bins. All the
+    // per-system arrays are indexed by graph index and are allocated once, so
+    // repeated attempts do no allocation and no map lookups.
+    class BinAssigner {
+    public:
+        explicit BinAssigner(const LinkGraph &graph);
+
+        // Try to assign every system in the region to a bin. Each "tries"
+        // loosens the quotas a bit more. Returns false if the quotas could not
+        // be met.
+        bool Assign(const vector<int> &region, const vector<int> &weights, int tries, Random &random, vector<int> &bin);
+
+    private:
+        // Narrow the range of bins allowed for every system near the given
+        // one, which has just been assigned to a bin.
+        void Propagate(int system, int choice);
+
+    private:
+        const LinkGraph &graph;
+        // The range of bins that each system may still be assigned to.
+        vector<int> low;
+        vector<int> high;
+        // Systems visited by the current propagation are marked with the
+        // current stamp, so the marks never need to be cleared.
+        vector<unsigned> visited;
+        unsigned stamp = 0;
+        // The breadth-first search frontier, reused between propagations.
+        vector<int> sources;
+        vector<int> next;
+        vector<int> unassigned;
+    };
+
+
+
+    BinAssigner::BinAssigner(const LinkGraph &graph)
+        : graph(graph), low(graph.Size()), high(graph.Size()), visited(graph.Size(), 0)
+    {
+    }
+
+
+
+    bool BinAssigner::Assign(const vector<int> &region, const vector<int> &weights, int tries, Random &random, vector<int> &bin)
+    {
+        // Each time we try 4 times to match the quota and are unable to,
+        // loosen the quota a little bit.
+        vector<int> quota;
+        for(int weight : weights)
+            quota.push_back((static_cast<int>(region.size()) * weight) / 100 + tries / 4 + 1);
+
+        unassigned = region;
+        for(int system : region)
+        {
+            low[system] = 0;
+            high[system] = static_cast<int>(quota.size());
+        }
+
+        while(!unassigned.empty())
+        {
+            int i = random.Int(static_cast<int>(unassigned.size()));
+            int system = unassigned[i];
+            unassigned[i] = unassigned.back();
+            unassigned.pop_back();
+
+            // Pick a bin, based on what is available.
+            int possibilities = 0;
+            for(int j = low[system]; j < high[system]; ++j)
+                possibilities += quota[j];
+            if(!possibilities)
+                return false;
+
+            // Pick a random one of those items to assign to it.
+            int index = random.Int(possibilities);
+            int choice = low[system];
+            while(true)
+            {
+                index -= quota[choice];
+                if(index < 0)
+                    break;
+                ++choice;
+            }
+            --quota[choice];
+
+            // Record our choice.
+            bin[system] = choice;
+            Propagate(system, choice);
+        }
+        return true;
+    }
+
+
+
+    // Narrow the range of bins allowed for every system near the given
+    // one, which has just been assigned to a bin.
+    void BinAssigner::Propagate(int system, int choice)
+    {
+        if(!++stamp)
+        {
+            fill(visited.begin(), visited.end(), 0);
+            stamp = 1;
+        }
+        visited[system] = stamp;
+
+        int newLow = low[system] = choice;
+        int newHigh = high[system] = choice + 1;
+
+        // Starting from this star, trace outwards system by system. Each
+        // neighboring system must be within 1 of this star's level; each
+        // system neighboring those, within 2, and so on.
+        sources.assign(1, system);
+        while(!sources.empty())
+        {
+            // For each step outward, expand the allowable range.
+            --newLow;
+            ++newHigh;
+
+            next.clear();
+            for(int source : sources)
+                for(int link : graph.Links(source))
+                {
+                    if(visited[link] == stamp)
+                        continue;
+                    visited[link] = stamp;
+
+                    // No need to go further if this system is already at
+                    // least as constrained as the new constraints.
+                    if(low[link] >= newLow && high[link] <= newHigh)
+                        continue;
+
+                    low[link] = max(low[link], newLow);
+                    high[link] = min(high[link], newHigh);
+                    next.push_back(link);
+                }
+
+            // Now, visit neighbors of those neighbors.
+            next.swap(sources);
+        }
+    }
+}
+
+
+
+// Assign new prices for the given commodity to every system reachable from
+// the given one. Returns false if no price distribution is defined for that
+// commodity, in which case nothing is changed.
+bool CommodityRandomizer::Randomize(const LinkGraph &graph, int start, const QString &commodity, Random &random)
+{
+    vector<int> region;
+    graph.Reachable(start, region);
+    vector<int> prices;
+    if(!Generate(graph, region, commodity, random, prices))
+        return false;
+
+    for(unsigned i = 0; i < region.size(); ++i)
+        graph.GetSystem(region[i])->SetTrade(commodity, prices[i]);
+    return true;
+}
+
+
+
+// Assign new prices for all the given commodities at once. Each commodity
+// is generated in parallel, with its own random number stream.
+void CommodityRandomizer::RandomizeAll(const LinkGraph &graph, int start, const vector<QString> &commodities, Random &random)
+{
+    struct Job {
+        QString commodity;
+        Random random;
+        vector<int> prices;
+        bool isValid;
+    };
+    vector<int> region;
+    graph.Reachable(start, region);
+    vector<Job> jobs;
+    for(const QString &commodity : commodities)
+        jobs.push_back({commodity, random.Split(), vector<int>(), false});
+
+    QtConcurrent::blockingMap(jobs, [&graph, &region](Job &job)
+    {
+        job.isValid = Generate(graph, region, job.commodity, job.random, job.prices);
+    });
+
+    // Setting the prices modifies each system's trade map, so it must not be
+    // done by more than one thread at once.
+    for(const Job &job : jobs)
+        if(job.isValid)
+            for(unsigned i = 0; i < region.size(); ++i)
+                graph.GetSystem(region[i])->SetTrade(job.commodity, job.prices[i]);
+}
+
+
+
+// Generate prices for the given commodity for each system in the region. The
+// prices are in the same order as the region.
+bool CommodityRandomizer::Generate(const LinkGraph &graph, const vector<int> &region, const QString &commodity, Random &random, vector<int> &prices)
+{
+    auto baseIt = BASE.find(commodity);
+    auto binIt = BINS.find(commodity);
+    if(region.empty() || baseIt == BASE.end() || binIt == BINS.end())
+        return false;
+    const int base = baseIt->second;
+
+    // Try to find a set of bins to assign the systems to such that neighboring
+    // systems only differ by one bin, and the desired distribution is achieved.
+    vector<int> bin;
+    FindBins(graph, region, binIt->second, random, bin);
+
+    // Assign each star system a value based on its bin.
+    vector<double> rough(graph.Size(), 0.);
+    for(int system : region)
+        rough[system] = base + random.Int(100) + 100 * bin[system];
+
+    // Smooth out the values by averaging each system with the average of all
+    // its neighbors. The region includes everything its systems link to, so
+    // the systems outside of it never affect the result.
+    PriceSmoother::Smooth(graph, rough, PriceSmoother::Settings());
+
+    prices.clear();
+    for(int system : region)
+        prices.push_back(static_cast<int>(floor(rough[system] + .5)));
+    return true;
+}
+
+
+
+// Find a bin for every system in the region. Each level of quota loosening
+// (i.e. each value of "tries") is an independent attempt with its own random
+// number stream, so a batch of them is tried in parallel and the lowest one
+// that succeeds is used. That is the same attempt a serial search would find,
+// however many threads are available.
+void CommodityRandomizer::FindBins(const LinkGraph &graph, const vector<int> &region, const vector<int> &weights, Random &random, vector<int> &bin)
+{
+    struct Attempt {
+        int tries;
+        vector<int> bin;
+    };
+    const uint64_t seed = random.Next();
+    const int batchSize = max(1, 2 * QThread::idealThreadCount());
+    vector<Attempt> attempts(batchSize);
+    for(int first = 0; true; first += batchSize)
+    {
+        atomic<int> best(numeric_limits<int>::max());
+        for(int i = 0; i < batchSize; ++i)
+            attempts[i].tries = first + i;
+
+        QtConcurrent::blockingMap(attempts, [&](Attempt &attempt)
+        {
+            // Skip this attempt if a lower one has already succeeded.
+            if(attempt.tries > best)
+                return;
+            Random stream(seed, attempt.tries);
+            BinAssigner assigner(graph);
+            attempt.bin.assign(graph.Size(), 0);
+            if(!assigner.Assign(region, weights, attempt.tries, stream, attempt.bin))
+                return;
+
+            int current = best;
+            while(attempt.tries < current && !best.compare_exchange_weak(current, attempt.tries))
+                continue;
+        });
+
+        if(best != numeric_limits<int>::max())
+        {
+            bin.swap(attempts[best - first].bin);
+            return;
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/* CommodityRandomizer.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef COMMODITYRANDOMIZER_H
+#define COMMODITYRANDOMIZER_H
+
+#include <QString>
+
+#include <vector>
+
+class LinkGraph;
+class Random;
+
+
+
+// Class for generating random commodity prices for a region of connected
+// systems. Each system is assigned to one of a few price levels ("bins"), such
+// that each bin gets roughly its desired share of the systems and neighboring
+// systems never differ by more than one bin. The prices are then picked within
+// each bin and smoothed out.
+class CommodityRandomizer {
+public:
+    // Assign new prices for the given commodity to every system reachable from
+    // the given one. Returns false if no price distribution is defined for that
+    // commodity, in which case nothing is changed.
+    static bool Randomize(const LinkGraph &graph, int start, const QString &commodity, Random &random);
+    // Assign new prices for all the given commodities at once. Each commodity
+    // is generated in parallel, with its own random number stream.
+    static void RandomizeAll(const LinkGraph &graph, int start, const std::vector<QString> &commodities, Random &random);
+
+
+private:
+    // Generate prices for the given commodity for each system in the region. The
+    // prices are in the same order as the region.
+    static bool Generate(const LinkGraph &graph, const std::vector<int> &region, const QString &commodity, Random &random, std::vector<int> &prices);
+    // Find a bin for every system in the region, trying several levels of quota
+    // loosening in parallel.
+    static void FindBins(const LinkGraph &graph, const std::vector<int> &region, const std::vector<int> &weights, Random &random, std::vector<int> &bin);
+};
+
+
+
+#endif // COMMODITYRANDOMIZER_H
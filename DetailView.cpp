@@ -216,10 +216,8 @@ void DetailView::GovernmentChanged()
 
     system->SetGovernment(newGov);
     galaxyView->SetGovernment(newGov);
-    mapData.SetChanged();
-
     // Refresh the Galaxy map since it is using a new Government color.
-    galaxyView->update();
+    galaxyView->SystemChanged(*system);
 }
 
 
@@ -242,8 +240,7 @@ void DetailView::CommodityChanged(int value)
     CommodityClicked(it->second, 0);
     system->SetTrade(it->second->text(0), value);
     it->second->setText(2, mapData.PriceLevel(it->second->text(0), value));
-    mapData.SetChanged();
-    galaxyView->update();
+    galaxyView->SystemChanged(*system);
 }
 
 
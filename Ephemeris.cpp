@@ -0,0 +1,126 @@
+/* Ephemeris.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "Ephemeris.h"
+
+#include "OrbitBatch.h"
+#include "StellarObject.h"
+#include "System.h"
+
+#include <cmath>
+#include <map>
+
+using namespace std;
+
+
+
+// Sample every object in the given system. More samples make for smoother
+// orbit trails and more accurate interpolation.
+void Ephemeris::Set(const System &system, int samples)
+{
+    Clear();
+    this->samples = max(4, samples);
+    revision = system.OrbitRevision();
+
+    // Every orbit is a circle, so the samples are just a unit circle scaled up
+    // to each object's distance. Calculate the unit circle once.
+    vector<double> turns;
+    for(int i = 0; i <= this->samples; ++i)
+        turns.push_back(static_cast<double>(i) / this->samples);
+    vector<double> sine(turns.size());
+    vector<double> cosine(turns.size());
+    OrbitBatch::SinCos(turns.data(), sine.data(), cosine.data(), static_cast<int>(turns.size()));
+
+    map<int, int> index;
+    for(const StellarObject *object : system.Objects())
+    {
+        index[object->Id()] = static_cast<int>(distance.size());
+        distance.push_back(object->Distance());
+        speed.push_back(object->Period() ? 1. / object->Period() : 0.);
+        phase.push_back(object->Offset() / 360.);
+        parent.push_back(object->Parent() >= 0 ? index[object->Parent()] : -1);
+
+        for(unsigned i = 0; i < turns.size(); ++i)
+            table.emplace_back(object->Distance() * sine[i], -object->Distance() * cosine[i]);
+    }
+}
+
+
+
+void Ephemeris::Clear()
+{
+    samples = 0;
+    revision = -1;
+    distance.clear();
+    speed.clear();
+    phase.clear();
+    parent.clear();
+    table.clear();
+}
+
+
+
+// Check if this ephemeris was made from the system's current orbits.
+bool Ephemeris::Matches(const System &system) const
+{
+    return samples && revision == system.OrbitRevision();
+}
+
+
+
+// Get the position of the given object on the given day.
+QVector2D Ephemeris::Position(int index, double day) const
+{
+    QVector2D position = Relative(index, day);
+    for(int i = parent[index]; i >= 0; i = parent[i])
+        position += Relative(i, day);
+    return position;
+}
+
+
+
+// Get the sampled orbit of the given object, relative to its parent. The
+// last point is a copy of the first, so the trail can be drawn as one
+// polyline.
+const QPointF *Ephemeris::Trail(int index) const
+{
+    return &table[index * TrailSize()];
+}
+
+
+
+int Ephemeris::TrailSize() const
+{
+    return samples + 1;
+}
+
+
+
+// Position of the given object relative to its parent.
+QVector2D Ephemeris::Relative(int index, double day) const
+{
+    // Find how far through its orbit this object is, as a fraction.
+    double turns = day * speed[index] + phase[index];
+    double sample = (turns - floor(turns)) * samples;
+    int i = min(samples - 1, static_cast<int>(sample));
+    double weight = sample - i;
+
+    const QPointF *trail = Trail(index);
+    QPointF point = trail[i] + (trail[i + 1] - trail[i]) * weight;
+
+    // Linear interpolation cuts across the chord between the two samples, so
+    // push the result back out onto the orbit's circle.
+    double length = sqrt(point.x() * point.x() + point.y() * point.y());
+    if(length)
+        point *= distance[index] / length;
+    return QVector2D(point);
+}
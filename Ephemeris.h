@@ -0,0 +1,75 @@
+/* Ephemeris.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <QPointF>
+#include <QVector2D>
+
+#include <vector>
+
+class System;
+
+
+
+// Class holding a table of precomputed positions for every stellar object in a
+// system, so that the positions on any day can be found by interpolation rather
+// than by evaluating each orbit. The orbital periods in a system generally have
+// no common multiple, so instead of sampling the whole system over one shared
+// period, each object is sampled over one full orbit around its parent. The
+// object's position on any day is then a lookup into its own table plus its
+// parent's position, which repeats exactly however far forward or back in time
+// the day is.
+class Ephemeris {
+public:
+    // Sample every object in the given system. More samples make for smoother
+    // orbit trails and more accurate interpolation.
+    void Set(const System &system, int samples = 256);
+    void Clear();
+
+    // Check if this ephemeris was made from the system's current orbits.
+    bool Matches(const System &system) const;
+
+    // Get the position of the given object on the given day.
+    QVector2D Position(int index, double day) const;
+
+    // Get the sampled orbit of the given object, relative to its parent. The
+    // last point is a copy of the first, so the trail can be drawn as one
+    // polyline.
+    const QPointF *Trail(int index) const;
+    int TrailSize() const;
+
+
+private:
+    // Position of the given object relative to its parent.
+    QVector2D Relative(int index, double day) const;
+
+
+private:
+    int samples = 0;
+    // The system's orbit revision when this table was made.
+    int revision = -1;
+
+    // Orbital elements, in turns (i.e. fractions of a full orbit).
+    std::vector<double> distance;
+    std::vector<double> speed;
+    std::vector<double> phase;
+    std::vector<int> parent;
+
+    // One block of (samples + 1) points for each object.
+    std::vector<QPointF> table;
+};
+
+
+
+#endif // EPHEMERIS_H
@@ -0,0 +1,161 @@
+/* GalaxyExporter.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "GalaxyExporter.h"
+
+#include "GalaxyRenderer.h"
+#include "Map.h"
+#include "PngWriter.h"
+#include "SpatialIndex.h"
+#include "System.h"
+#include "TileCache.h"
+#include "TileRenderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // Empty space to leave around the outermost systems, in map units.
+    static const double MARGIN = 100.;
+    // PNG images cannot be any wider or taller than this.
+    static const double MAX_SIZE = numeric_limits<int>::max();
+}
+
+
+
+// Draw the map and save it to the given path. If anything goes wrong, this
+// returns false and stores a description of the problem in the error.
+bool GalaxyExporter::Export(Map &map, const QString &path, const Options &options, QString *error)
+{
+    QRectF bounds = options.bounds.isNull() ? Bounds(map) : options.bounds.normalized();
+    double scale = options.scale;
+    if(!(scale > 0.))
+    {
+        *error = "The scale must be greater than zero.";
+        return false;
+    }
+    if(bounds.isEmpty())
+    {
+        *error = "There is nothing to draw.";
+        return false;
+    }
+
+    // Find the pixels that the bounds cover. Tile (0, 0) starts at pixel
+    // (0, 0), so the image is probably not lined up with the tiles.
+    double left = floor(bounds.left() * scale);
+    double top = floor(bounds.top() * scale);
+    double right = ceil(bounds.right() * scale);
+    double bottom = ceil(bounds.bottom() * scale);
+    if(right - left > MAX_SIZE || bottom - top > MAX_SIZE
+            || fabs(left) > MAX_SIZE || fabs(top) > MAX_SIZE
+            || fabs(right) > MAX_SIZE || fabs(bottom) > MAX_SIZE)
+    {
+        *error = "The image would be too big to save.";
+        return false;
+    }
+    int x0 = left;
+    int y0 = top;
+    int width = right - left;
+    int height = bottom - top;
+
+    PngWriter writer(path, width, height);
+    if(!writer.IsGood())
+    {
+        *error = "Unable to write to \"" + path + "\".";
+        return false;
+    }
+
+    SpatialIndex index;
+    index.Build(map);
+    GalaxyRenderer renderer(map, &index);
+    GalaxyRenderer::Style style;
+    style.commodity = options.commodity;
+    style.government = options.government;
+    style.showNames = options.showNames;
+    renderer.SetStyle(style);
+    renderer.Refresh();
+    TileRenderer tileRenderer(renderer);
+    const int size = TileCache::TILE_SIZE;
+
+    // Floor division, so that pixels left of or above the origin are in the
+    // tiles with negative coordinates.
+    auto tileOf = [size](int pixel) -> int
+    {
+        return (pixel >= 0) ? pixel / size : -((size - 1 - pixel) / size);
+    };
+    int firstColumn = tileOf(x0);
+    int lastColumn = tileOf(x0 + width - 1);
+    int firstRow = tileOf(y0);
+    int lastRow = tileOf(y0 + height - 1);
+
+    vector<TileRenderer::Tile> tiles(lastColumn - firstColumn + 1);
+    vector<QRgb> line(width);
+    for(int row = firstRow; row <= lastRow; ++row)
+    {
+        for(int column = firstColumn; column <= lastColumn; ++column)
+        {
+            tiles[column - firstColumn].x = column;
+            tiles[column - firstColumn].y = row;
+        }
+        tileRenderer.Render(tiles, scale);
+
+        // Copy the part of each tile's scan lines that is inside the image.
+        int startY = max(y0, row * size);
+        int endY = min(y0 + height, (row + 1) * size);
+        for(int y = startY; y < endY; ++y)
+        {
+            for(const TileRenderer::Tile &tile : tiles)
+            {
+                int startX = max(x0, tile.x * size);
+                int endX = min(x0 + width, (tile.x + 1) * size);
+                const QRgb *source = reinterpret_cast<const QRgb *>(tile.image.constScanLine(y - row * size));
+                copy(source + (startX - tile.x * size), source + (endX - tile.x * size), line.begin() + (startX - x0));
+            }
+            writer.AddRow(line.data());
+        }
+    }
+
+    if(!writer.Finish())
+    {
+        *error = "Unable to write to \"" + path + "\".";
+        return false;
+    }
+    return true;
+}
+
+
+
+// Get the area that includes every system in the map, plus a margin.
+QRectF GalaxyExporter::Bounds(const Map &map)
+{
+    if(map.Systems().empty())
+        return QRectF();
+
+    QVector2D first = map.Systems().begin()->second.Position();
+    double left = first.x();
+    double top = first.y();
+    double right = left;
+    double bottom = top;
+    for(const auto &it : map.Systems())
+    {
+        const QVector2D &pos = it.second.Position();
+        left = min<double>(left, pos.x());
+        top = min<double>(top, pos.y());
+        right = max<double>(right, pos.x());
+        bottom = max<double>(bottom, pos.y());
+    }
+    return QRectF(left, top, right - left, bottom - top).adjusted(-MARGIN, -MARGIN, MARGIN, MARGIN);
+}
@@ -0,0 +1,52 @@
+/* GalaxyExporter.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef GALAXYEXPORTER_H
+#define GALAXYEXPORTER_H
+
+#include <QRectF>
+#include <QString>
+
+class Map;
+
+
+
+// Class for saving a picture of the galaxy map to a PNG file, without any
+// window. The map is drawn one row of tiles at a time and each row is written
+// out as soon as it is done, so the image can be far bigger than would fit in
+// memory.
+class GalaxyExporter {
+public:
+    struct Options {
+        // Pixels per unit of map distance.
+        double scale = 1.;
+        // The area of the map to draw. If this is null, it is every system
+        // plus a margin around them.
+        QRectF bounds;
+        // Color the systems by this commodity's price, or by government.
+        QString commodity;
+        QString government;
+        bool showNames = true;
+    };
+
+
+public:
+    // Draw the map and save it to the given path. If anything goes wrong, this
+    // returns false and stores a description of the problem in the error.
+    static bool Export(Map &map, const QString &path, const Options &options, QString *error);
+    // Get the area that includes every system in the map, plus a margin.
+    static QRectF Bounds(const Map &map);
+};
+
+
+
+#endif // GALAXYEXPORTER_H
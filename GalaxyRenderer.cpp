@@ -0,0 +1,887 @@
+/* GalaxyRenderer.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "GalaxyRenderer.h"
+
+#include "JumpDistances.h"
+#include "LinkGraph.h"
+#include "Map.h"
+#include "SpatialIndex.h"
+#include "SpriteSet.h"
+#include "System.h"
+
+#include <QFont>
+#include <QFontMetricsF>
+#include <QLineF>
+#include <QPainter>
+#include <QPolygonF>
+#include <QTransform>
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+    // When coloring by jump distance, up to this many characters are added to
+    // the end of each system's name.
+    static const int LABEL_SUFFIX = 6;
+
+    // Zoom levels at which less and less detail is drawn. Below the first,
+    // only some systems are labeled, and below the second, none are. Below
+    // the third, systems are drawn as points instead of circles, and below
+    // the last, only the number of systems in each part of the map is shown.
+    static const double ALL_LABELS_SCALE = .5;
+    static const double LABEL_SCALE = .125;
+    static const double POINT_SCALE = .25;
+    static const double DENSITY_SCALE = .0625;
+    // Sizes on the screen, in pixels, of the cells used to pick which systems
+    // are labeled, of the cells used to show density, and of each point.
+    static const double LABEL_CELL_WIDTH = 96.;
+    static const double LABEL_CELL_HEIGHT = 32.;
+    static const double DENSITY_CELL = 4.;
+    static const double POINT_SIZE = 3.;
+
+    // Get a key for the cell that the given point is in, in a grid of cells of
+    // the given size.
+    int64_t CellKey(const QPointF &point, double width, double height)
+    {
+        int x = floor(point.x() / width);
+        int y = floor(point.y() / height);
+        return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y));
+    }
+
+    // Expand the given area to the edges of the cells that it touches.
+    QRectF SnapToCells(const QRectF &area, double width, double height)
+    {
+        return QRectF(
+            QPointF(floor(area.left() / width) * width, floor(area.top() / height) * height),
+            QPointF((floor(area.right() / width) + 1.) * width, (floor(area.bottom() / height) + 1.) * height));
+    }
+
+    // Map a value between -1 and 1 to a color.
+    QColor MapColor(double value)
+    {
+        value = min(1., max(-1., value));
+        if(value < 0.)
+            return QColor(
+                (.12 + .12 * value) * 255.9,
+                (.48 + .36 * value) * 255.9,
+                (.48 - .12 * value) * 255.9);
+        else
+            return QColor(
+                (.12 + .48 * value) * 255.9,
+                (.48 + .00 * value) * 255.9,
+                (.48 - .48 * value) * 255.9);
+    }
+    // Get the color of a density cell with the given number of systems in it,
+    // whose values add up to the given total.
+    QColor DensityColor(double total, int count)
+    {
+        QColor color = MapColor(total / count);
+        color.setAlphaF(min(1., .4 + .2 * count));
+        return color;
+    }
+    QColor MapGrey(double value)
+    {
+        value = max(0., min(1., (value + 1.) / 2.));
+        return QColor(
+            200. * value + 55.9,
+            200. * value + 55.9,
+            200. * value + 55.9);
+    }
+
+    // Links are drawn in this many shades of grey. Each shade is used for an
+    // equal part of the range of values from -1 to 1.
+    static const int LINK_SHADES = 50;
+    // Links with a value of 1 or more are shown in red instead.
+    int LinkShade(double value)
+    {
+        if(value >= 1.)
+            return LINK_SHADES;
+        return max(0, min(LINK_SHADES - 1, static_cast<int>((value + 1.) * .5 * LINK_SHADES)));
+    }
+    QColor ShadeColor(int shade)
+    {
+        if(shade >= LINK_SHADES)
+            return QColor(255, 0, 0);
+        return MapGrey((2. * shade + 1.) / LINK_SHADES - 1.);
+    }
+
+    // Make copies of the given image at half size, then quarter size, and so
+    // on, so that it never has to be shrunk by more than half when drawn.
+    vector<QImage> MipChain(const QImage &image)
+    {
+        vector<QImage> levels(1, image);
+        while(levels.back().width() > 1 && levels.back().height() > 1)
+        {
+            const QImage &last = levels.back();
+            levels.push_back(last.scaled(last.width() / 2, last.height() / 2,
+                Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+        }
+        return levels;
+    }
+}
+
+
+
+bool GalaxyRenderer::Style::operator==(const Style &other) const
+{
+    return commodity == other.commodity && government == other.government
+        && distances == other.distances && graph == other.graph && origin == other.origin
+        && showNames == other.showNames;
+}
+
+
+
+bool GalaxyRenderer::Style::operator!=(const Style &other) const
+{
+    return !(*this == other);
+}
+
+
+
+// The index is used to find the systems in the area being drawn. Without
+// one, every system in the map has to be checked.
+GalaxyRenderer::GalaxyRenderer(const Map &map, SpatialIndex *index)
+    : map(map), index(index)
+{
+    QFontMetricsF metrics{QFont()};
+    charWidth = metrics.maxWidth();
+    ascent = metrics.ascent();
+    descent = metrics.descent();
+}
+
+
+
+// Changing how the map is colored means Refresh() must be called again.
+void GalaxyRenderer::SetStyle(const Style &style)
+{
+    // Forget the colors if they are based on something else now. Whether
+    // names are shown does not change any of the colors.
+    Style previous = this->style;
+    previous.showNames = style.showNames;
+    this->style = style;
+    if(previous != style)
+        colors.clear();
+}
+
+
+
+const GalaxyRenderer::Style &GalaxyRenderer::GetStyle() const
+{
+    return style;
+}
+
+
+
+// Measure the longest link and the longest name in the map, which decide
+// how far outside an area a system can be and still be drawn in it, load
+// any new background images, draw the names of any new or renamed systems,
+// and figure out what color every system and link should be. This must be
+// called after any change to the map other than the ones that can be handled
+// by Extend() or Update().
+void GalaxyRenderer::Refresh()
+{
+    // Load any new background images.
+    std::map<QString, vector<QImage>> loaded;
+    for(const Galaxy &it : map.Galaxies())
+    {
+        auto sit = sprites.find(it.Sprite());
+        loaded[it.Sprite()] = (sit != sprites.end()) ? sit->second : MipChain(SpriteSet::Get(it.Sprite()).toImage());
+    }
+    sprites.swap(loaded);
+
+    // Forget the names of any systems that have been renamed or deleted. This
+    // also drops the jump numbers, which are quick to draw again.
+    for(auto &cached : labels)
+        for(auto it = cached.second.begin(); it != cached.second.end(); )
+        {
+            if(map.Systems().count(it->first))
+                ++it;
+            else
+                it = cached.second.erase(it);
+        }
+
+    longestLink = 0.;
+    longestName = 0;
+    colors.clear();
+    for(const auto &it : map.Systems())
+    {
+        Extend(it.second);
+        Recolor(it.second);
+    }
+}
+
+
+
+void GalaxyRenderer::Extend(const System &system)
+{
+    longestName = max(longestName, system.Name().size());
+    for(const QString &link : system.Links())
+    {
+        auto it = map.Systems().find(link);
+        if(it != map.Systems().end())
+            longestLink = max<double>(longestLink, (it->second.Position() - system.Position()).length());
+    }
+}
+
+
+
+// Call this after changing a system's links, prices, or government.
+void GalaxyRenderer::Update(const System &system)
+{
+    Extend(system);
+    Recolor(system);
+    // The color of each link depends on both of the systems it connects.
+    for(const QString &link : system.Links())
+    {
+        auto it = map.Systems().find(link);
+        if(it != map.Systems().end())
+            Recolor(it->second);
+    }
+}
+
+
+
+// Call this before drawing from several threads at once, at the given zoom
+// level. Drawing only adds to the cache of names, which is guarded by a
+// lock, so it is safe as long as the map does not change. This must not be
+// called while anything is being drawn.
+void GalaxyRenderer::Prepare(double scale)
+{
+    if(index)
+        index->Update();
+
+    // Names drawn for any other zoom level are not likely to be needed again.
+    for(auto it = labels.begin(); it != labels.end(); )
+    {
+        if(it->first == scale)
+            ++it;
+        else
+            it = labels.erase(it);
+    }
+}
+
+
+
+// Leave the given system and its links out of everything that is drawn,
+// e.g. because it is being dragged and is drawn separately. Changing this
+// changes what the area around that system looks like.
+void GalaxyRenderer::SetHidden(const System *system)
+{
+    hidden = system;
+}
+
+
+
+const System *GalaxyRenderer::Hidden() const
+{
+    return hidden;
+}
+
+
+
+// Draw everything that is inside the given area of the map, at the given
+// zoom level. The painter must already be set up to draw in map coordinates.
+void GalaxyRenderer::Draw(QPainter &painter, const QRectF &area, double scale) const
+{
+    // Draw the "galaxy" images, using the smallest copy of each one that
+    // still has at least one pixel for every pixel on the screen.
+    int level = (scale < 1.) ? floor(log2(1. / scale)) : 0;
+    for(const Galaxy &it : map.Galaxies())
+    {
+        auto sit = sprites.find(it.Sprite());
+        if(sit == sprites.end())
+            continue;
+        const QImage &sprite = sit->second.front();
+        QPointF pos = (it.Position() - QVector2D(.5 * sprite.width(), .5 * sprite.height())).toPointF();
+        QRectF bounds(pos, QSizeF(sprite.width(), sprite.height()));
+        if(bounds.intersects(area))
+        {
+            const QImage &source = sit->second[min<size_t>(level, sit->second.size() - 1)];
+            painter.drawImage(bounds, source, QRectF(source.rect()));
+        }
+    }
+
+    // When zoomed far out, individual systems are too small to see.
+    if(scale < DENSITY_SCALE)
+    {
+        DrawDensity(painter, area, scale);
+        return;
+    }
+
+    // When zoomed out, only some systems are labeled: the map is divided into
+    // cells about the size of a name, and only the system in each cell with
+    // the most links gets one. The cells do not depend on which area is being
+    // drawn, so the same systems are labeled in every tile.
+    bool allLabels = style.showNames && (scale >= ALL_LABELS_SCALE);
+    bool someLabels = style.showNames && (scale >= LABEL_SCALE);
+    double cellWidth = LABEL_CELL_WIDTH / scale;
+    double cellHeight = LABEL_CELL_HEIGHT / scale;
+
+    // Find every system that might have a link, a point or a name inside the
+    // area. A link can only cross the area if both its ends are within one link
+    // length of it, a point is a few pixels wide however small the systems
+    // are, and a name is drawn to the right of its system. Whether a name is
+    // shown also depends on every other system in the same cell.
+    bool asPoints = (scale < POINT_SCALE);
+    double pointMargin = asPoints ? .5 * POINT_SIZE / scale : 0.;
+    double labelWidth = LabelWidth();
+    double labelHeight = LabelHeight();
+    double labelMargin = max(labelWidth, labelHeight);
+    if(someLabels && !allLabels)
+        labelMargin += max(cellWidth, cellHeight);
+    double margin = max(max(longestLink + 1., labelMargin), pointMargin);
+    QRectF reach = area.adjusted(-margin, -margin, margin, margin);
+    vector<const System *> nearby;
+    if(index)
+    {
+        vector<System *> found;
+        index->Rect(reach, found);
+        nearby.assign(found.begin(), found.end());
+    }
+    else
+        for(const auto &it : map.Systems())
+            if(reach.contains(it.second.Position().toPointF()))
+                nearby.push_back(&it.second);
+    if(hidden)
+        nearby.erase(remove(nearby.begin(), nearby.end(), hidden), nearby.end());
+    // Draw the systems in the same order in every tile, so that any names
+    // that overlap each other line up where two tiles meet.
+    sort(nearby.begin(), nearby.end());
+
+    // Draw the links between systems, skipping any that do not pass through
+    // the area. Links are one unit wide. The links are sorted into a few
+    // shades of grey, plus red, and all the links of each color are drawn at
+    // once.
+    QRectF linkArea = area.adjusted(-1., -1., 1., 1.);
+    vector<QVector<QLineF>> shades(LINK_SHADES + 1);
+    Colors scratch;
+    for(const System *system : nearby)
+    {
+        QPointF pos = system->Position().toPointF();
+        for(const LinkColor &link : FindColors(*system, scratch).links)
+        {
+            // Links to the hidden system are left out even if it does not
+            // list them.
+            if(link.other == hidden)
+                continue;
+            // If both systems list this link, only draw it from the first one.
+            if(link.isMutual && link.other < system && binary_search(nearby.begin(), nearby.end(), link.other))
+                continue;
+            QPointF end = link.other->Position().toPointF();
+            if(Intersects(linkArea, pos, end))
+                shades[link.shade].append(QLineF(pos, end));
+        }
+    }
+    painter.setBrush(Qt::NoBrush);
+    for(int i = 0; i <= LINK_SHADES; ++i)
+        if(!shades[i].isEmpty())
+        {
+            painter.setPen(QPen(ShadeColor(i)));
+            painter.drawLines(shades[i]);
+        }
+
+    // Pick which system in each cell gets a name.
+    std::map<int64_t, const System *> labeled;
+    if(someLabels && !allLabels)
+        for(const System *system : nearby)
+        {
+            const System *&best = labeled[CellKey(system->Position().toPointF(), cellWidth, cellHeight)];
+            if(!best || system->Links().size() > best->Links().size())
+                best = system;
+        }
+
+    // Draw the systems, colored by commodity or if the government is the
+    // selected government. If they are too small to draw as circles, draw
+    // them as points instead, all the points of each color at once. The
+    // names are drawn last, so nothing is drawn on top of them.
+    static const QPen blackPen;
+    std::map<QRgb, QPolygonF> points;
+    vector<pair<const System *, int>> named;
+    QRectF systemArea = area.adjusted(-max(labelWidth, pointMargin), -max(labelHeight, pointMargin),
+        max(labelHeight, pointMargin), max(labelHeight, pointMargin));
+    for(const System *system : nearby)
+    {
+        QPointF pos = system->Position().toPointF();
+        if(!systemArea.contains(pos))
+            continue;
+
+        const Colors &systemColors = FindColors(*system, scratch);
+        if(asPoints)
+            points[systemColors.color.rgb()].append(pos);
+        else if(QRectF(pos - QPointF(6., 6.), QSizeF(12., 12.)).intersects(area))
+        {
+            painter.setBrush(QBrush(systemColors.color));
+            painter.setPen(blackPen);
+            painter.drawEllipse(pos, 5, 5);
+        }
+
+        if(allLabels || (someLabels && labeled[CellKey(pos, cellWidth, cellHeight)] == system))
+            named.emplace_back(system, systemColors.jumps);
+    }
+    for(const auto &it : points)
+    {
+        QPen pen{QColor(it.first)};
+        pen.setWidthF(POINT_SIZE);
+        pen.setCosmetic(true);
+        painter.setPen(pen);
+        painter.drawPoints(it.second);
+    }
+    for(const pair<const System *, int> &it : named)
+        DrawLabel(painter, *it.first, it.second, it.first->Position().toPointF(), area);
+}
+
+
+
+// Draw a single system and its name. A highlighted system is brighter. If
+// an area is given, only the parts of the system inside it are drawn.
+void GalaxyRenderer::DrawSystem(QPainter &painter, const System &system, bool isHighlighted,
+    const QRectF &area) const
+{
+    static const QPen blackPen;
+
+    QPointF pos = system.Position().toPointF();
+    Colors scratch;
+    const Colors &systemColors = FindColors(system, scratch);
+    QColor color = systemColors.color;
+    if(isHighlighted)
+        color.setRgbF(color.redF() * 1.5, color.greenF() * 1.5, color.blueF() * 1.5);
+    painter.setBrush(QBrush(color));
+    painter.setPen(blackPen);
+    if(area.isNull() || QRectF(pos - QPointF(6., 6.), QSizeF(12., 12.)).intersects(area))
+        painter.drawEllipse(pos, 5, 5);
+
+    DrawLabel(painter, system, systemColors.jumps, pos, area);
+}
+
+
+
+// Draw the hidden system, its links, and the links to it from the given
+// systems, the same way Draw() would at the given zoom level.
+void GalaxyRenderer::DrawHidden(QPainter &painter, const QRectF &area, double scale,
+    const vector<System *> &linkedFrom) const
+{
+    static const QPen blackPen;
+
+    if(!hidden)
+        return;
+    QPointF pos = hidden->Position().toPointF();
+    Colors scratch;
+    const Colors &hiddenColors = FindColors(*hidden, scratch);
+
+    // When zoomed far out, this system is a cell of its own on top of the
+    // cell that the tiles show without it.
+    if(scale < DENSITY_SCALE)
+    {
+        double size = DENSITY_CELL / scale;
+        QPointF corner(floor(pos.x() / size) * size, floor(pos.y() / size) * size);
+        painter.fillRect(QRectF(corner, QSizeF(size, size)), DensityColor(hiddenColors.value, 1));
+        return;
+    }
+
+    DrawLinks(painter, *hidden, area);
+    for(const System *other : linkedFrom)
+        DrawLinks(painter, *other, area, hidden);
+
+    if(scale < POINT_SCALE)
+    {
+        QPen pen(hiddenColors.color);
+        pen.setWidthF(POINT_SIZE);
+        pen.setCosmetic(true);
+        painter.setPen(pen);
+        painter.drawPoint(pos);
+    }
+    else if(QRectF(pos - QPointF(6., 6.), QSizeF(12., 12.)).intersects(area))
+    {
+        painter.setBrush(QBrush(hiddenColors.color));
+        painter.setPen(blackPen);
+        painter.drawEllipse(pos, 5, 5);
+    }
+    if(IsLabeled(*hidden, scale))
+        DrawLabel(painter, *hidden, hiddenColors.jumps, pos, area);
+}
+
+
+
+// Draw all the links of a single system that pass through the given area.
+// If another system is given, only the link to that system is drawn.
+void GalaxyRenderer::DrawLinks(QPainter &painter, const System &system, const QRectF &area,
+    const System *to) const
+{
+    QPointF pos = system.Position().toPointF();
+    Colors scratch;
+    painter.setBrush(Qt::NoBrush);
+    for(const LinkColor &link : FindColors(system, scratch).links)
+    {
+        if(to && link.other != to)
+            continue;
+        QPointF end = link.other->Position().toPointF();
+        if(!Intersects(area, pos, end))
+            continue;
+        painter.setPen(QPen(ShadeColor(link.shade)));
+        painter.drawLine(pos, end);
+    }
+}
+
+
+
+// Get the area that the given system covers when drawn at the given
+// position, including its name.
+QRectF GalaxyRenderer::SystemBounds(const System &system, const QVector2D &position) const
+{
+    Colors scratch;
+    int jumps = FindColors(system, scratch).jumps;
+    QPointF pos = position.toPointF();
+    return QRectF(pos - QPointF(6., 6.), QSizeF(12., 12.)).united(LabelBounds(system, jumps, pos));
+}
+
+
+
+// Get the area that might look different at the given zoom level if anything
+// inside the given area of the map changes.
+QRectF GalaxyRenderer::ChangedArea(const QRectF &area, double scale) const
+{
+    if(area.isNull())
+        return QRectF();
+
+    // A system's position decides which density cell it is counted in.
+    if(scale < DENSITY_SCALE)
+        return SnapToCells(area, DENSITY_CELL / scale, DENSITY_CELL / scale);
+
+    // Points are the same size on screen however far out the map is zoomed,
+    // so they can reach farther from a system than its circle does.
+    QRectF changed = area;
+    if(scale < POINT_SCALE)
+    {
+        double margin = .5 * POINT_SIZE / scale;
+        changed.adjust(-margin, -margin, margin, margin);
+    }
+
+    // Which system in a cell is labeled depends on every system in that cell.
+    if(scale >= LABEL_SCALE && scale < ALL_LABELS_SCALE)
+    {
+        QRectF cells = SnapToCells(area, LABEL_CELL_WIDTH / scale, LABEL_CELL_HEIGHT / scale);
+        return changed.united(cells.adjusted(-6., -LabelHeight(), LabelWidth(), LabelHeight()));
+    }
+    return changed;
+}
+
+
+
+// Check whether any part of the line between the given points is inside
+// the given area.
+bool GalaxyRenderer::Intersects(const QRectF &area, const QPointF &start, const QPointF &end)
+{
+    // Clip the line against each edge of the area in turn, keeping track of
+    // which part of it (from 0 to 1) is still left. If nothing is left, the
+    // line is entirely outside the area.
+    QPointF delta = end - start;
+    const double along[4] = {-delta.x(), delta.x(), -delta.y(), delta.y()};
+    const double inside[4] = {
+        start.x() - area.left(), area.right() - start.x(),
+        start.y() - area.top(), area.bottom() - start.y()};
+    double low = 0.;
+    double high = 1.;
+    for(int i = 0; i < 4; ++i)
+    {
+        // A line parallel to this edge is either all inside it or all outside.
+        if(!along[i])
+        {
+            if(inside[i] < 0.)
+                return false;
+            continue;
+        }
+        double t = inside[i] / along[i];
+        if(along[i] < 0.)
+            low = max(low, t);
+        else
+            high = min(high, t);
+        if(low > high)
+            return false;
+    }
+    return true;
+}
+
+
+
+GalaxyRenderer::Colors GalaxyRenderer::GetColors(const System &system) const
+{
+    Colors result;
+    result.value = SystemValue(system, &result.jumps);
+    result.color = MapColor(result.value);
+    for(const QString &link : system.Links())
+    {
+        auto it = map.Systems().find(link);
+        if(it == map.Systems().end())
+            continue;
+        double value = LinkValue(system, it->second);
+        int shade = LinkShade(value);
+        bool isMutual = it->second.Links().count(system.Name());
+        result.links.push_back(LinkColor{&it->second, shade, isMutual});
+    }
+    return result;
+}
+
+
+
+void GalaxyRenderer::Recolor(const System &system)
+{
+    colors[&system] = GetColors(system);
+}
+
+
+
+// Look up the colors of the given system. If it has not been colored yet,
+// they are figured out and stored in the given scratch space.
+const GalaxyRenderer::Colors &GalaxyRenderer::FindColors(const System &system, Colors &scratch) const
+{
+    auto it = colors.find(&system);
+    if(it != colors.end())
+        return it->second;
+    scratch = GetColors(system);
+    return scratch;
+}
+
+
+
+// Get the color "value" of a link or system, from -1 to 1, based on the
+// current style.
+double GalaxyRenderer::LinkValue(const System &first, const System &second) const
+{
+    if(!style.commodity.isEmpty())
+    {
+        int difference = abs(first.Trade(style.commodity) - second.Trade(style.commodity));
+        return (difference - 60) / 60.;
+    }
+    else if(style.distances)
+        return 0.;
+    else if(!style.government.isEmpty())
+        return (first.Government() != second.Government());
+    return 0.;
+}
+
+
+
+// If coloring by jump distance, also get the number of jumps to the system,
+// or zero if it cannot be reached.
+double GalaxyRenderer::SystemValue(const System &system, int *jumps) const
+{
+    if(!style.commodity.isEmpty())
+        return map.MapPrice(style.commodity, system.Trade(style.commodity)) * 2. - 1.;
+    else if(style.distances && style.graph)
+    {
+        // Nearby systems are brightest. Anything out of reach is dark.
+        int index = style.graph->Index(&system);
+        int distance = (index < 0) ? -1 : style.distances->Distance(style.origin, index);
+        if(jumps)
+            *jumps = max(0, distance);
+        return (distance < 0) ? -1. : 1. - .25 * min(distance, 8);
+    }
+    else if(!style.government.isEmpty())
+        return (system.Government() == style.government);
+    return 0.;
+}
+
+
+
+// Get the area covered by a system's name, drawn at the given position.
+// If the number of jumps is not zero, it is added after the name.
+QRectF GalaxyRenderer::LabelBounds(const System &system, int jumps, const QPointF &position) const
+{
+    // The name is drawn with its baseline just below the system, and its
+    // shadow is offset by one more unit. Rather than measuring the name,
+    // assume every character is as wide as the widest one.
+    int length = system.Name().size() + (jumps ? QString::number(jumps).size() + 3 : 0);
+    QRectF text(5., 5. - ascent, length * charWidth + 1., ascent + descent + 1.);
+    return text.adjusted(-1., -1., 1., 1.).translated(position);
+}
+
+
+
+// Draw a system's name next to it, if any of the name is inside the given
+// area. A null area means to always draw it.
+void GalaxyRenderer::DrawLabel(QPainter &painter, const System &system, int jumps, const QPointF &position,
+    const QRectF &area) const
+{
+    if(!area.isNull() && !LabelBounds(system, jumps, position).intersects(area))
+        return;
+
+    // The names are drawn at the resolution of whatever is being painted on,
+    // and lined up with its pixels, so that they are never stretched. The
+    // images have a one unit margin around the text.
+    QTransform transform = painter.transform();
+    double scale = transform.m11();
+    if(!(scale > 0.))
+        return;
+    QPointF corner = transform.map(position + QPointF(4., 4. - ascent));
+    Label name = FindLabel(system.Name(), scale);
+
+    painter.setTransform(QTransform());
+    painter.drawImage(QPoint(round(corner.x()), round(corner.y())), name.image);
+    if(jumps > 0)
+    {
+        Label number = FindLabel(" (" + QString::number(jumps) + ")", scale);
+        corner.rx() += name.width * scale;
+        painter.drawImage(QPoint(round(corner.x()), round(corner.y())), number.image);
+    }
+    painter.setTransform(transform);
+}
+
+
+
+// Draw how many systems are in each small square of the given area. The
+// squares are a fixed number of pixels wide, and are colored by the average
+// value of the systems in them.
+void GalaxyRenderer::DrawDensity(QPainter &painter, const QRectF &area, double scale) const
+{
+    double size = DENSITY_CELL / scale;
+    struct Cell {
+        QPointF corner;
+        int count = 0;
+        double value = 0.;
+    };
+    std::map<int64_t, Cell> cells;
+    Colors scratch;
+    auto add = [&cells, &scratch, size, this](const System &system)
+    {
+        if(&system == hidden)
+            return;
+        QPointF pos = system.Position().toPointF();
+        Cell &cell = cells[CellKey(pos, size, size)];
+        cell.corner = QPointF(floor(pos.x() / size) * size, floor(pos.y() / size) * size);
+        ++cell.count;
+        cell.value += FindColors(system, scratch).value;
+    };
+    if(index)
+    {
+        vector<System *> found;
+        index->Rect(area, found);
+        for(const System *system : found)
+            add(*system);
+    }
+    else
+        for(const auto &it : map.Systems())
+            if(area.contains(it.second.Position().toPointF()))
+                add(it.second);
+
+    // Cells with more systems in them are brighter.
+    for(const auto &it : cells)
+    {
+        const Cell &cell = it.second;
+        painter.fillRect(QRectF(cell.corner, QSizeF(size, size)), DensityColor(cell.value, cell.count));
+    }
+}
+
+
+
+// Check whether the given system gets a name at the given zoom level.
+bool GalaxyRenderer::IsLabeled(const System &system, double scale) const
+{
+    if(!style.showNames || scale < LABEL_SCALE)
+        return false;
+    if(scale >= ALL_LABELS_SCALE)
+        return true;
+
+    // Otherwise, Draw() names the system in each cell with the most links, or
+    // the first one in pointer order if several have the same number.
+    double width = LABEL_CELL_WIDTH / scale;
+    double height = LABEL_CELL_HEIGHT / scale;
+    QPointF pos = system.Position().toPointF();
+    int64_t key = CellKey(pos, width, height);
+    auto beats = [&system, key, width, height, this](const System &other) -> bool
+    {
+        if(&other == &system || &other == hidden || CellKey(other.Position().toPointF(), width, height) != key)
+            return false;
+        size_t links = other.Links().size();
+        return links > system.Links().size() || (links == system.Links().size() && &other < &system);
+    };
+    if(index)
+    {
+        vector<System *> found;
+        index->Rect(SnapToCells(QRectF(pos, pos), width, height), found);
+        for(const System *other : found)
+            if(beats(*other))
+                return false;
+    }
+    else
+        for(const auto &it : map.Systems())
+            if(beats(it.second))
+                return false;
+    return true;
+}
+
+
+
+// How far a name can extend to the right of, and above or below, its system.
+double GalaxyRenderer::LabelWidth() const
+{
+    return (longestName + LABEL_SUFFIX) * charWidth + 8.;
+}
+
+
+
+double GalaxyRenderer::LabelHeight() const
+{
+    return ascent + descent + 8.;
+}
+
+
+
+// Draw a piece of text and its shadow at the given zoom level, so that it
+// can just be copied onto the map wherever it is needed.
+GalaxyRenderer::Label GalaxyRenderer::RenderLabel(const QString &text, double scale) const
+{
+    static const QColor bright(180, 180, 180);
+
+    QFontMetricsF metrics{QFont()};
+    Label label;
+    label.width = metrics.width(text);
+    label.image = QImage(ceil((label.width + 3.) * scale), ceil((ascent + descent + 3.) * scale),
+        QImage::Format_ARGB32_Premultiplied);
+    label.image.fill(Qt::transparent);
+
+    QPainter painter(&label.image);
+    painter.setRenderHint(QPainter::TextAntialiasing, true);
+    painter.scale(scale, scale);
+    painter.setPen(Qt::black);
+    painter.drawText(QPointF(2., 2. + ascent), text);
+    painter.setPen(bright);
+    painter.drawText(QPointF(1., 1. + ascent), text);
+    return label;
+}
+
+
+
+// Get the image of the given text at the given zoom level, drawing it if
+// this is the first time it is needed at that zoom level.
+GalaxyRenderer::Label GalaxyRenderer::FindLabel(const QString &text, double scale) const
+{
+    QMutexLocker lock(&labelMutex);
+    std::map<QString, Label> &cached = labels[scale];
+    auto it = cached.find(text);
+    if(it != cached.end())
+        return it->second;
+
+    // Draw the text without holding the lock, so that other threads can keep
+    // drawing. If two threads draw the same text, the first one is kept.
+    lock.unlock();
+    Label label = RenderLabel(text, scale);
+    lock.relock();
+    return cached.emplace(text, label).first->second;
+}
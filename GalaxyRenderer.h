@@ -0,0 +1,212 @@
+/* GalaxyRenderer.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef GALAXYRENDERER_H
+#define GALAXYRENDERER_H
+
+#include <QColor>
+#include <QImage>
+#include <QMutex>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QVector2D>
+
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+class JumpDistances;
+class LinkGraph;
+class Map;
+class SpatialIndex;
+class System;
+
+class QPainter;
+
+
+
+// Class for drawing the parts of the galaxy map that only change when the map
+// itself is edited: the background galaxy images, the hyperspace links, and the
+// systems and their names. Things that change as the user works, like the
+// selection, are drawn separately on top of this. Only the systems and links
+// that are inside the area being drawn are ever looked at, so drawing a small
+// part of a huge map is still fast.
+class GalaxyRenderer {
+public:
+    // How to color the systems and links.
+    struct Style {
+        QString commodity;
+        QString government;
+        // If given, color the systems by how many jumps they are from the
+        // system with the given index in the link graph.
+        const JumpDistances *distances = nullptr;
+        const LinkGraph *graph = nullptr;
+        int origin = -1;
+        // Whether to draw the names of the systems.
+        bool showNames = true;
+
+        bool operator==(const Style &other) const;
+        bool operator!=(const Style &other) const;
+    };
+
+
+public:
+    // The index is used to find the systems in the area being drawn. Without
+    // one, every system in the map has to be checked.
+    explicit GalaxyRenderer(const Map &map, SpatialIndex *index = nullptr);
+
+    // Changing how the map is colored means Refresh() must be called again.
+    void SetStyle(const Style &style);
+    const Style &GetStyle() const;
+
+    // Measure the longest link and the longest name in the map, which decide
+    // how far outside an area a system can be and still be drawn in it, load
+    // any new background images, draw the names of any new or renamed systems,
+    // and figure out what color every system and link should be. This must be
+    // called after any change to the map other than the ones that can be
+    // handled by Extend() or Update().
+    void Refresh();
+    // Call this after moving a system.
+    void Extend(const System &system);
+    // Call this after changing a system's links, prices, or government.
+    void Update(const System &system);
+    // Call this before drawing from several threads at once, at the given zoom
+    // level. Drawing only adds to the cache of names, which is guarded by a
+    // lock, so it is safe as long as the map does not change. This must not be
+    // called while anything is being drawn.
+    void Prepare(double scale);
+    // Leave the given system and its links out of everything that is drawn,
+    // e.g. because it is being dragged and is drawn separately. Changing this
+    // changes what the area around that system looks like.
+    void SetHidden(const System *system);
+    const System *Hidden() const;
+
+    // Draw everything that is inside the given area of the map, at the given
+    // zoom level. The painter must already be set up to draw in map coordinates.
+    // When zoomed out, fewer names are drawn, systems are drawn as points, and
+    // eventually only the density of systems is shown.
+    void Draw(QPainter &painter, const QRectF &area, double scale) const;
+    // Draw a single system and its name. A highlighted system is brighter. If
+    // an area is given, only the parts of the system inside it are drawn.
+    void DrawSystem(QPainter &painter, const System &system, bool isHighlighted = false,
+        const QRectF &area = QRectF()) const;
+    // Draw the hidden system, its links, and the links to it from the given
+    // systems, the same way Draw() would at the given zoom level.
+    void DrawHidden(QPainter &painter, const QRectF &area, double scale,
+        const std::vector<System *> &linkedFrom) const;
+    // Draw all the links of a single system that pass through the given area.
+    // If another system is given, only the link to that system is drawn.
+    void DrawLinks(QPainter &painter, const System &system, const QRectF &area,
+        const System *to = nullptr) const;
+
+    // Get the area that the given system covers when drawn at the given
+    // position, including its name.
+    QRectF SystemBounds(const System &system, const QVector2D &position) const;
+    // Get the area that might look different at the given zoom level if anything
+    // inside the given area of the map changes.
+    QRectF ChangedArea(const QRectF &area, double scale) const;
+
+    // Check whether any part of the line between the given points is inside
+    // the given area.
+    static bool Intersects(const QRectF &area, const QPointF &start, const QPointF &end);
+
+
+private:
+    // The color of a system and of each of its links, based on the current
+    // style. Rather than figuring these out every time the map is drawn, they
+    // are only updated when the style or the map changes.
+    struct LinkColor {
+        const System *other;
+        int shade;
+        // Whether the other system also lists this link.
+        bool isMutual;
+    };
+    struct Colors {
+        double value = 0.;
+        QColor color;
+        int jumps = 0;
+        std::vector<LinkColor> links;
+    };
+    Colors GetColors(const System &system) const;
+    void Recolor(const System &system);
+    // Look up the colors of the given system. If it has not been colored yet,
+    // they are figured out and stored in the given scratch space.
+    const Colors &FindColors(const System &system, Colors &scratch) const;
+
+    // Get the color "value" of a link or system, from -1 to 1, based on the
+    // current style.
+    double LinkValue(const System &first, const System &second) const;
+    // If coloring by jump distance, also get the number of jumps to the system,
+    // or zero if it cannot be reached.
+    double SystemValue(const System &system, int *jumps = nullptr) const;
+    // Get the area covered by a system's name, drawn at the given position.
+    // If the number of jumps is not zero, it is added after the name.
+    QRectF LabelBounds(const System &system, int jumps, const QPointF &position) const;
+    // Draw a system's name next to it, if any of the name is inside the given
+    // area. A null area means to always draw it.
+    void DrawLabel(QPainter &painter, const System &system, int jumps, const QPointF &position,
+        const QRectF &area) const;
+    // Draw how many systems are in each small square of the given area.
+    void DrawDensity(QPainter &painter, const QRectF &area, double scale) const;
+    // Check whether the given system gets a name at the given zoom level.
+    bool IsLabeled(const System &system, double scale) const;
+    // How far a name can extend to the right of, and above or below, its system.
+    double LabelWidth() const;
+    double LabelHeight() const;
+
+
+private:
+    // A piece of text and its shadow, drawn once for each zoom level so that it
+    // can just be copied onto the map wherever it is needed.
+    struct Label {
+        QImage image;
+        double width = 0.;
+    };
+    Label RenderLabel(const QString &text, double scale) const;
+    // Get the image of the given text at the given zoom level, drawing it if
+    // this is the first time it is needed at that zoom level.
+    Label FindLabel(const QString &text, double scale) const;
+
+
+private:
+    const Map &map;
+    SpatialIndex *index;
+    Style style;
+    const System *hidden = nullptr;
+
+    // The longest link and the longest label in the map.
+    double longestLink = 0.;
+    int longestName = 0;
+
+    // The names of the systems, and the numbers that are added to the names
+    // when coloring by jump distance, at each zoom level they were needed at.
+    // Any thread that is drawing may add to these.
+    mutable QMutex labelMutex;
+    mutable std::map<double, std::map<QString, Label>> labels;
+    std::unordered_map<const System *, Colors> colors;
+    // The background images. These are images rather than pixmaps so that they
+    // can be drawn from any thread. Each one is stored at full size, then half
+    // size, and so on, so that zooming out does not mean shrinking a huge
+    // image every time it is drawn.
+    std::map<QString, std::vector<QImage>> sprites;
+
+    // Size of the largest character in the label font, for a quick estimate
+    // of how much space a label might take up.
+    double charWidth = 0.;
+    double ascent = 0.;
+    double descent = 0.;
+};
+
+
+
+#endif // GALAXYRENDERER_H
@@ -12,57 +12,57 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "GalaxyView.h"
 
+#include "BatchGenerator.h"
+#include "CommodityRandomizer.h"
 #include "DetailView.h"
+#include "GalaxyRenderer.h"
+#include "LayoutRelaxer.h"
+#include "LayoutValidator.h"
+#include "LinkAnalysis.h"
+#include "LinkGenerator.h"
+#include "LinkGraph.h"
 #include "Map.h"
-#include "SpriteSet.h"
+#include "PriceSmoother.h"
+#include "Random.h"
+#include "SpatialIndex.h"
 #include "SystemView.h"
-
+#include "TileCache.h"
+#include "TileRenderer.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QElapsedTimer>
+#include <QFormLayout>
+#include <QImage>
 #include <QInputDialog>
+#include <QLineF>
 #include <QMessageBox>
 #include <QPainter>
 #include <QPalette>
 #include <QMouseEvent>
+#include <QSpinBox>
 #include <QTabWidget>
+#include <QVector>
 #include <QVector2D>
 
 #include <algorithm>
 #include <cmath>
-#include <map>
 #include <set>
-#include <stack>
 
 using namespace std;
 
 namespace {
-    // Map a value between -1 and 1 to a color.
-    QColor MapColor(double value)
-    {
-        value = min(1., max(-1., value));
-        if(value < 0.)
-            return QColor(
-                (.12 + .12 * value) * 255.9,
-                (.48 + .36 * value) * 255.9,
-                (.48 - .12 * value) * 255.9);
-        else
-            return QColor(
-                (.12 + .48 * value) * 255.9,
-                (.48 + .00 * value) * 255.9,
-                (.48 - .48 * value) * 255.9);
-    }
-    QColor MapGrey(double value)
-    {
-        value = max(0., min(1., (value + 1.) / 2.));
-        return QColor(
-            200. * value + 55.9,
-            200. * value + 55.9,
-            200. * value + 55.9);
-    }
+    // How far out the view can be zoomed. Very large maps can be zoomed out
+    // far enough that only the density of systems is shown.
+    static const double MIN_SCALE = 1. / 256.;
 }
 
 
 
 GalaxyView::GalaxyView(Map &mapData, QTabWidget *tabs, QWidget *parent) :
-    QWidget(parent), mapData(mapData), tabs(tabs)
+    QWidget(parent), mapData(mapData), tabs(tabs), renderer(mapData, &systemIndex), tileRenderer(renderer)
 {
     setAutoFillBackground(true);
     QPalette p = palette();
@@ -73,6 +73,9 @@ GalaxyView::GalaxyView(Map &mapData, QTabWidget *tabs, QWidget *parent) :
         "Use the scroll wheel to zoom in and out.");
 
     Center();
+    analysis.Build(mapData);
+    systemIndex.Build(mapData);
+    connect(&relaxTimer, SIGNAL(timeout()), this, SLOT(RelaxStep()));
 }
 
 
@@ -91,6 +94,21 @@ void GalaxyView::Center()
 
 
 
+// Forget anything cached about the map, e.g. because systems were added,
+// removed, or renamed, or a new map was loaded.
+void GalaxyView::Reload()
+{
+    renderer.SetHidden(nullptr);
+    analysis.Invalidate();
+    systemIndex.Invalidate();
+    selection.clear();
+    proposedLinks.clear();
+    relaxer.Stop();
+    relaxTimer.stop();
+}
+
+
+
 void GalaxyView::SetSystemView(SystemView *view)
 {
     systemView = view;
@@ -108,10 +126,11 @@ void GalaxyView::SetDetailView(DetailView *view)
 // Color the map by this commodity.
 void GalaxyView::SetCommodity(const QString &name)
 {
-    if(commodity != name)
+    if(commodity != name || showDistances)
     {
         commodity = name;
         government.clear();
+        showDistances = false;
         update();
     }
 }
@@ -121,16 +140,31 @@ void GalaxyView::SetCommodity(const QString &name)
 // Color the map by this government.
 void GalaxyView::SetGovernment(const QString &name)
 {
-    if(government != name)
+    if(government != name || showDistances)
     {
         government = name;
         commodity.clear();
+        showDistances = false;
         update();
     }
 }
 
 
 
+// Call this after changing a system's prices or government, so that only
+// the parts of the map that look different are redrawn.
+void GalaxyView::SystemChanged(const System &system)
+{
+    renderer.Update(system);
+    // The color of a link depends on both systems, even if only one lists it.
+    for(const System *other : OneSidedLinks(system))
+        renderer.Update(*other);
+    MapChanged(MoveArea(system, system.Position()));
+    update();
+}
+
+
+
 void GalaxyView::KeyPress(QKeyEvent *event)
 {
     if(event->key() == Qt::Key_Delete || event->key() == Qt::Key_Backspace)
@@ -182,6 +216,9 @@ bool GalaxyView::RenameSystem(const QString &from, const QString &to)
     {
         mapData.RenameSystem(from, to);
         mapData.SetChanged();
+        Reload();
+        if(pinned.erase(from))
+            pinned.insert(to);
 
         // Update the system pointed to by the two views, as the old pointer is invalid.
         System *newSystem = &mapData.Systems()[to];
@@ -225,8 +262,10 @@ void GalaxyView::DeleteSystem()
         }
 
         // Remove this system from known systems.
+        pinned.erase(system->Name());
         mapData.Systems().erase(system->Name());
         mapData.SetChanged();
+        Reload();
     }
     update();
 }
@@ -249,181 +288,458 @@ void GalaxyView::RandomizeCommodity()
     if(commodity.isEmpty() || !systemView || !systemView->Selected())
         return;
     
-    // Next, find all the systems connected via hyperlinks to the current system.
-    set<System *> connected;
-    stack<System *> edge;
-    edge.push(systemView->Selected());
-    while(!edge.empty())
-    {
-        System *system = edge.top();
-        edge.pop();
-        
-        if(connected.count(system))
-            continue;
-        connected.insert(system);
-        
-        for(const QString &name : system->Links())
-            if(mapData.Systems().count(name))
-                edge.push(&mapData.Systems()[name]);
-    }
-    
-    // Commodity parameters.
-    static const map<QString, int> BASE = {
-        {"Clothing", 140},
-        {"Electronics", 590},
-        {"Equipment", 330},
-        {"Food", 100},
-        {"Heavy Metals", 610},
-        {"Industrial", 520},
-        {"Luxury Goods", 920},
-        {"Medical", 430},
-        {"Metal", 190},
-        {"Plastic", 240}
-    };
-    static const map<QString, vector<int>> BINS = {
-        {"Clothing", {20, 60, 20}},
-        {"Electronics", {30, 40, 30}},
-        {"Equipment", {30, 20, 20, 30}},
-        {"Food", {24, 18, 16, 18, 24}},
-        {"Heavy Metals", {8, 12, 20, 20, 20, 12, 8}},
-        {"Industrial", {20, 30, 30, 20}},
-        {"Luxury Goods", {25, 20, 15, 10, 10, 20}},
-        {"Medical", {20, 20, 20, 20, 20}},
-        {"Metal", {30, 25, 20, 25}},
-        {"Plastic", {40, 20, 40}}
-    };
-    auto baseIt = BASE.find(commodity);
-    auto binIt = BINS.find(commodity);
-    if(baseIt == BASE.end() || binIt == BINS.end())
+    // The entire region connected to the selected system gets new prices.
+    const LinkGraph &graph = analysis.Graph();
+    Random random = Random::Operation();
+    if(!CommodityRandomizer::Randomize(graph, graph.Index(systemView->Selected()), commodity, random))
         return;
     
-    // Generate the quotas for each bin level.
-    const int base = baseIt->second;
-    
-    // Try to find a set of bins to assign the systems to such that neighboring
-    // systems only differ by one bin, and the desired distribution is achieved.
-    map<const System *, int> bin;
-    for(int tries = 0; true; ++tries)
-    {
-        // Each time we try 4 times to match the quota and are unable to,
-        // loosen the quota a little bit.
-        vector<int> quota;
-        for(int weight : binIt->second)
-            quota.emplace_back((connected.size() * weight) / 100 + tries / 4 + 1);
-        
-        vector<const System *> unassigned;
-        map<const System *, int> low;
-        map<const System *, int> high;
-        for(const System *system : connected)
+    mapData.SetChanged();
+    if(detailView)
+        detailView->UpdateCommodities();
+    update();
+}
+
+
+
+// Randomize the values of every commodity at once, for the entire region
+// connected to the selected system.
+void GalaxyView::RandomizeAllCommodities()
+{
+    if(!systemView || !systemView->Selected())
+        return;
+
+    vector<QString> names;
+    for(const Map::Commodity &it : mapData.Commodities())
+        names.push_back(it.name);
+
+    const LinkGraph &graph = analysis.Graph();
+    Random random = Random::Operation();
+    CommodityRandomizer::RandomizeAll(graph, graph.Index(systemView->Selected()), names, random);
+
+    mapData.SetChanged();
+    if(detailView)
+        detailView->UpdateCommodities();
+    update();
+}
+
+
+
+// Smooth out the prices of one commodity, or all of them, across the whole
+// galaxy, by moving each system's price toward the average of its neighbors.
+void GalaxyView::SmoothPrices()
+{
+    const vector<Map::Commodity> &commodities = mapData.Commodities();
+    if(commodities.empty())
+        return;
+
+    QDialog dialog(this);
+    dialog.setWindowTitle("Smooth prices");
+    QFormLayout *layout = new QFormLayout(&dialog);
+
+    QComboBox *commodityBox = new QComboBox(&dialog);
+    commodityBox->addItem("(all)");
+    for(const Map::Commodity &it : commodities)
+        commodityBox->addItem(it.name);
+    if(!commodity.isEmpty())
+        commodityBox->setCurrentText(commodity);
+    layout->addRow("Commodity:", commodityBox);
+
+    QSpinBox *iterationsBox = new QSpinBox(&dialog);
+    iterationsBox->setRange(1, 100);
+    iterationsBox->setValue(1);
+    layout->addRow("Passes:", iterationsBox);
+
+    // In each pass, a system's price moves this far toward its neighbors'.
+    QSpinBox *strengthBox = new QSpinBox(&dialog);
+    strengthBox->setRange(0, 100);
+    strengthBox->setValue(50);
+    layout->addRow("Strength (%):", strengthBox);
+
+    QCheckBox *pinBox = new QCheckBox("Keep the selected system's prices", &dialog);
+    pinBox->setChecked(systemView && systemView->Selected());
+    layout->addRow(pinBox);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, SIGNAL(accepted()), &dialog, SLOT(accept()));
+    connect(buttons, SIGNAL(rejected()), &dialog, SLOT(reject()));
+    layout->addRow(buttons);
+    if(dialog.exec() != QDialog::Accepted)
+        return;
+
+    const LinkGraph &graph = analysis.Graph();
+    const int count = graph.Size();
+    vector<char> pinned(count, 0);
+    if(pinBox->isChecked() && systemView && systemView->Selected())
+    {
+        int selected = graph.Index(systemView->Selected());
+        if(selected >= 0)
+            pinned[selected] = 1;
+    }
+
+    PriceSmoother::Settings settings;
+    settings.iterations = iterationsBox->value();
+    settings.selfWeight = 1. - strengthBox->value() / 100.;
+
+    vector<double> values(count);
+    vector<double> weights(count);
+    vector<char> fixed(count);
+    for(const Map::Commodity &it : commodities)
+    {
+        if(commodityBox->currentIndex() && it.name != commodityBox->currentText())
+            continue;
+
+        // A system that does not trade in this commodity keeps its lack of a
+        // price, and does not pull its neighbors' prices toward zero.
+        for(int i = 0; i < count; ++i)
         {
-            unassigned.push_back(system);
-            low[system] = 0;
-            high[system] = quota.size();
+            values[i] = graph.GetSystem(i)->Trade(it.name);
+            weights[i] = values[i] ? 1. : 0.;
+            fixed[i] = pinned[i] || !values[i];
         }
-        
-        while(!unassigned.empty())
+        settings.low = it.low;
+        settings.high = it.high;
+        PriceSmoother::Smooth(graph, values, settings, weights, fixed);
+
+        for(int i = 0; i < count; ++i)
+            if(!fixed[i])
+                graph.GetSystem(i)->SetTrade(it.name, static_cast<int>(floor(values[i] + .5)));
+    }
+
+    mapData.SetChanged();
+    if(detailView)
+        detailView->UpdateCommodities();
+    update();
+}
+
+
+
+// Propose links between nearby systems, based on their positions. The
+// proposed links are drawn on the map, and can then be accepted all at once.
+void GalaxyView::ProposeLinks()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Propose links");
+    QFormLayout *layout = new QFormLayout(&dialog);
+
+    QComboBox *ruleBox = new QComboBox(&dialog);
+    ruleBox->addItems({"Relative neighborhood (fewer links)", "Gabriel (more links)"});
+    layout->addRow("Rule:", ruleBox);
+
+    QSpinBox *lengthBox = new QSpinBox(&dialog);
+    lengthBox->setRange(10, 1000);
+    lengthBox->setValue(150);
+    layout->addRow("Longest link:", lengthBox);
+
+    QCheckBox *selectionBox = new QCheckBox("Only the selected systems", &dialog);
+    selectionBox->setChecked(!selection.empty());
+    selectionBox->setEnabled(!selection.empty());
+    layout->addRow(selectionBox);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, SIGNAL(accepted()), &dialog, SLOT(accept()));
+    connect(buttons, SIGNAL(rejected()), &dialog, SLOT(reject()));
+    layout->addRow(buttons);
+    if(dialog.exec() != QDialog::Accepted)
+        return;
+
+    vector<System *> systems = selection;
+    if(!selectionBox->isChecked())
+    {
+        systems.clear();
+        for(auto &it : mapData.Systems())
+            systems.push_back(&it.second);
+    }
+
+    LinkGenerator::Options options;
+    options.maxLength = lengthBox->value();
+    options.relativeNeighborhood = (ruleBox->currentIndex() == 0);
+    proposedLinks = LinkGenerator::Propose(systems, options);
+    if(proposedLinks.empty())
+    {
+        QMessageBox::information(this, "Propose links", "No new links to propose.");
+        return;
+    }
+
+    // Show the proposed links while asking whether to keep them.
+    update();
+    QMessageBox::StandardButton button = QMessageBox::question(this, "Propose links",
+        "Add the " + QString::number(proposedLinks.size()) + " proposed links (shown in green)?");
+    if(button == QMessageBox::Yes)
+    {
+        for(const pair<System *, System *> &link : proposedLinks)
+            link.first->ToggleLink(link.second);
+        analysis.Invalidate();
+        mapData.SetChanged();
+    }
+    proposedLinks.clear();
+    update();
+}
+
+
+
+// Pin or unpin the selected system. Relaxing the layout never moves a pinned
+// system, even if it is selected.
+void GalaxyView::TogglePin()
+{
+    if(!systemView || !systemView->Selected())
+        return;
+
+    const QString &name = systemView->Selected()->Name();
+    if(!pinned.erase(name))
+        pinned.insert(name);
+    update();
+}
+
+
+
+// Spread out the selected systems so that they are not too crowded, while
+// keeping linked systems close together. The systems move a little bit at a
+// time, so you can watch them settle. Doing this again while the systems are
+// still moving stops them where they are.
+void GalaxyView::RelaxLayout()
+{
+    if(relaxer.IsActive())
+    {
+        relaxer.Stop();
+        relaxTimer.stop();
+        return;
+    }
+    if(selection.empty())
+    {
+        QMessageBox::information(this, "Relax layout",
+            "Hold Shift and drag on the background to select the systems to relax.");
+        return;
+    }
+
+    vector<System *> pins;
+    for(const QString &name : pinned)
+    {
+        auto it = mapData.Systems().find(name);
+        if(it != mapData.Systems().end())
+            pins.push_back(&it->second);
+    }
+    relaxer.Start(mapData, selection, pins, LayoutRelaxer::Options());
+    relaxTimer.start(1000 / 60);
+}
+
+
+
+// Regenerate the stars, planets, asteroids, and minables of every system that
+// matches a filter, all at once.
+void GalaxyView::RegenerateSystems()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("Regenerate systems");
+    QFormLayout *layout = new QFormLayout(&dialog);
+
+    // Offer every government in the map, starting with the one the map is
+    // currently colored by (if any).
+    set<QString> governments;
+    for(const auto &it : mapData.Systems())
+        if(!it.second.Government().isEmpty())
+            governments.insert(it.second.Government());
+    QComboBox *governmentBox = new QComboBox(&dialog);
+    governmentBox->addItem("(any)");
+    for(const QString &name : governments)
+        governmentBox->addItem(name);
+    if(!government.isEmpty())
+        governmentBox->setCurrentText(government);
+    layout->addRow("Government:", governmentBox);
+
+    QCheckBox *uninhabitedBox = new QCheckBox("Skip inhabited systems", &dialog);
+    uninhabitedBox->setChecked(true);
+    layout->addRow(uninhabitedBox);
+
+    QCheckBox *selectionBox = new QCheckBox("Only the selected systems", &dialog);
+    selectionBox->setChecked(!selection.empty());
+    selectionBox->setEnabled(!selection.empty());
+    layout->addRow(selectionBox);
+
+    QComboBox *layoutBox = new QComboBox(&dialog);
+    layoutBox->addItems({"Keep", "Randomize", "Randomize (Inhabited)", "Randomize (Uninhabited)"});
+    layoutBox->setCurrentIndex(3);
+    layout->addRow("Stars and planets:", layoutBox);
+
+    QCheckBox *asteroidsBox = new QCheckBox("Change asteroids", &dialog);
+    asteroidsBox->setChecked(true);
+    layout->addRow(asteroidsBox);
+    QCheckBox *minablesBox = new QCheckBox("Change minables", &dialog);
+    minablesBox->setChecked(true);
+    layout->addRow(minablesBox);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, SIGNAL(accepted()), &dialog, SLOT(accept()));
+    connect(buttons, SIGNAL(rejected()), &dialog, SLOT(reject()));
+    layout->addRow(buttons);
+    if(dialog.exec() != QDialog::Accepted)
+        return;
+
+    BatchGenerator::Filter filter;
+    if(governmentBox->currentIndex())
+        filter.government = governmentBox->currentText();
+    filter.uninhabitedOnly = uninhabitedBox->isChecked();
+    if(selectionBox->isChecked())
+        filter.only.insert(selection.begin(), selection.end());
+
+    BatchGenerator::Options options;
+    options.layout = (layoutBox->currentIndex() != 0);
+    options.allowHabitable = (layoutBox->currentIndex() != 3);
+    options.requireHabitable = (layoutBox->currentIndex() == 2);
+    options.asteroids = asteroidsBox->isChecked();
+    options.minables = minablesBox->isChecked();
+
+    vector<System *> systems = BatchGenerator::Select(mapData, filter);
+    if(systems.empty())
+    {
+        QMessageBox::information(this, "Regenerate systems", "No systems match those settings.");
+        return;
+    }
+    if(!BatchGenerator::Run(systems, options, this))
+        return;
+
+    // The selected system's objects have all been replaced, so reselect it to
+    // clear any selection of one of its objects.
+    if(systemView && systemView->Selected())
+        systemView->Select(systemView->Selected());
+    mapData.SetChanged();
+    update();
+}
+
+
+
+// Check every system's stellar objects for overlapping orbits, mismatched
+// periods, and other problems, and report them.
+void GalaxyView::CheckLayout()
+{
+    QElapsedTimer timer;
+    timer.start();
+    vector<pair<const System *, QString>> problems = LayoutValidator::Check(mapData);
+    QString time = " (" + QString::number(timer.elapsed()) + " ms)";
+
+    if(problems.empty())
+    {
+        QMessageBox::information(this, "Check layout",
+            "No problems found in " + QString::number(mapData.Systems().size()) + " systems." + time);
+        return;
+    }
+
+    set<const System *> systems;
+    QString details;
+    for(const auto &problem : problems)
+    {
+        systems.insert(problem.first);
+        details += problem.first->Name() + ": " + problem.second + "\n";
+    }
+    QMessageBox box(QMessageBox::Warning, "Check layout",
+        "Found " + QString::number(problems.size()) + " problems in "
+            + QString::number(systems.size()) + " systems." + time, QMessageBox::Ok, this);
+    box.setDetailedText(details);
+    box.exec();
+}
+
+
+
+// Show or hide the groups of systems that are cut off from the rest of the
+// map, and the links and systems that are the only way in or out of a region.
+void GalaxyView::ToggleChokepoints()
+{
+    showChokepoints = !showChokepoints;
+    update();
+}
+
+
+
+// Color the systems by how many jumps away they are from the selected one,
+// instead of by a commodity or government.
+void GalaxyView::ToggleJumpDistances()
+{
+    showDistances = !showDistances;
+    if(showDistances)
+    {
+        commodity.clear();
+        government.clear();
+    }
+    update();
+}
+
+
+
+void GalaxyView::ToggleNames()
+{
+    showNames = !showNames;
+    update();
+}
+
+
+
+// Time how long it takes to draw everything on the screen from scratch, with
+// and without the system names.
+void GalaxyView::TimeDrawing()
+{
+    static const int FRAMES = 10;
+
+    // Make sure the renderer is up to date first.
+    repaint();
+
+    QRect visible = VisibleTiles(Origin());
+    vector<TileRenderer::Tile> all;
+    for(int y = visible.top(); y <= visible.bottom(); ++y)
+        for(int x = visible.left(); x <= visible.right(); ++x)
         {
-            int i = rand() % unassigned.size();
-            const System *system = unassigned[i];
-            unassigned[i] = unassigned.back();
-            unassigned.pop_back();
-            
-            // Pick a bin, based on what is available.
-            int possibilities = 0;
-            for(int i = low[system]; i < high[system]; ++i)
-                possibilities += quota[i];
-            if(!possibilities)
-                break;
-            
-            // Pick a random one of those items to assign to it.
-            int index = rand() % possibilities;
-            int choice = low[system];
-            while(true)
-            {
-                index -= quota[choice];
-                if(index < 0)
-                    break;
-                ++choice;
-            }
-            --quota[choice];
-            
-            // Record our choice.
-            bin[system] = choice;
-            int newLow = low[system] = choice;
-            int newHigh = high[system] = choice + 1;
-            
-            // Starting from this star, trace outwards system by system. Each
-            // neighboring system must be within 1 of this star's level; each
-            // system neighboring those, within 2, and so on.
-            vector<const System *> sources = {system};
-            set<const System *> done = {system};
-            while(!sources.empty())
-            {
-                // For each step outward, expand the allowable range.
-                --newLow;
-                ++newHigh;
-                
-                vector<const System *> next;
-                
-                // Check if any systems adjacent to any of the sources must be
-                // updated.
-                for(const System *source : sources)
-                    for(const QString &name : source->Links())
-                    {
-                        auto it = mapData.Systems().find(name);
-                        if(it == mapData.Systems().end() || done.count(&it->second))
-                            continue;
-                        const System *link = &it->second;
-                        done.insert(link);
-                        
-                        // No need to go further if this system is already at
-                        // least as constrained as the new constraints.
-                        if(low[link] >= newLow && high[link] <= newHigh)
-                            continue;
-                        
-                        low[link] = max(low[link], newLow);
-                        high[link] = min(high[link], newHigh);
-                        next.push_back(link);
-                    }
-                
-                // Now, visit neighbors of those neighbors.
-                next.swap(sources);
-            }
+            all.emplace_back();
+            all.back().x = x;
+            all.back().y = y;
         }
-        if(unassigned.empty())
-            break;
+
+    GalaxyRenderer::Style style = renderer.GetStyle();
+    double elapsed[2];
+    for(int i = 0; i < 2; ++i)
+    {
+        GalaxyRenderer::Style timed = style;
+        timed.showNames = !i;
+        renderer.SetStyle(timed);
+
+        QElapsedTimer timer;
+        timer.start();
+        for(int frame = 0; frame < FRAMES; ++frame)
+            tileRenderer.Render(all, scale);
+        elapsed[i] = timer.nsecsElapsed() * .000001 / FRAMES;
     }
-    
-    // Assign each star system a value based on its bin.
-    map<const System *, int> rough;
-    for(const auto &it : bin)
-        rough[it.first] = base + (rand() % 100) + 100 * it.second;
-    
-    // Smooth out the values by averaging each system with the average of all
-    // its neighbors.
-    for(System *system : connected)
-    {
-        int count = 0;
-        int sum = 0;
-        for(const QString &link : system->Links())
-            if(mapData.Systems().count(link))
-            {
-                sum += rough[&mapData.Systems()[link]];
-                ++count;
-            }
+    renderer.SetStyle(style);
 
-        if(!count)
-            sum = rough[system];
-        else
+    QMessageBox::information(this, "Drawing Time",
+        "Drawing " + QString::number(visible.width() * visible.height()) + " tiles takes "
+        + QString::number(elapsed[0], 'f', 1) + " ms with system names, and "
+        + QString::number(elapsed[1], 'f', 1) + " ms without them.");
+}
+
+
+
+// Take a few steps of relaxing the layout, and then redraw the map.
+void GalaxyView::RelaxStep()
+{
+    // Checking the cached tiles is not free, so do it once for everything
+    // that moved in all of the steps.
+    QRectF changed;
+    for(int i = 0; i < 5; ++i)
+    {
+        bool isActive = relaxer.Step();
+        const vector<System *> &moving = relaxer.Moving();
+        for(unsigned j = 0; j < moving.size(); ++j)
         {
-            sum += count * rough[system];
-            sum = (sum + count) / (2 * count);
+            systemIndex.Move(moving[j], relaxer.Previous()[j]);
+            renderer.Extend(*moving[j]);
+            changed = changed.united(MoveArea(*moving[j], relaxer.Previous()[j]));
+        }
+        if(!isActive)
+        {
+            relaxTimer.stop();
+            break;
         }
-        system->SetTrade(commodity, sum);
     }
-    mapData.SetChanged();
-    if(detailView)
-        detailView->UpdateCommodities();
+    if(!changed.isNull())
+        MapChanged(changed);
     update();
 }
 
@@ -433,19 +749,22 @@ void GalaxyView::mousePressEvent(QMouseEvent *event)
 {
     clickOff = QVector2D(event->pos()) - offset;
 
-    dragSystem = nullptr;
     QVector2D origin = MapPoint(event->pos());
-    for(auto &it : mapData.Systems())
-        if(origin.distanceToPoint(it.second.Position()) < 10.)
-        {
-            dragSystem = &it.second;
-            break;
-        }
+    dragSystem = systemIndex.Nearest(origin, 10.);
 
     if(!dragSystem)
     {
         if(event->button() == Qt::RightButton)
             CreateSystem(origin);
+        // Shift-dragging on the background selects a rectangle of systems
+        // instead of panning the view.
+        else if(event->button() == Qt::LeftButton && (event->modifiers() & Qt::ShiftModifier))
+        {
+            isSelecting = true;
+            selectStart = origin;
+            selectEnd = origin;
+            update();
+        }
         return;
     }
     // An existing system was clicked. Select it, or toggle a link with the
@@ -467,8 +786,17 @@ void GalaxyView::mousePressEvent(QMouseEvent *event)
     {
         if(systemView && systemView->Selected())
         {
-            systemView->Selected()->ToggleLink(dragSystem);
-            mapData.SetChanged();
+            System *selected = systemView->Selected();
+            selected->ToggleLink(dragSystem);
+            analysis.ToggleLink(selected, dragSystem);
+            renderer.Update(*selected);
+            renderer.Update(*dragSystem);
+            // Changing a link changes the jump distances to every system.
+            if(showDistances)
+                mapData.SetChanged();
+            else
+                MapChanged(QRectF(selected->Position().toPointF(), dragSystem->Position().toPointF())
+                    .normalized().adjusted(-1., -1., 1., 1.));
             update();
         }
         dragSystem = nullptr;
@@ -486,14 +814,12 @@ void GalaxyView::mouseDoubleClickEvent(QMouseEvent *event)
     if(!tabs || !systemView)
         return;
 
-    QVector2D origin = MapPoint(event->pos());
-    for(auto &it : mapData.Systems())
-        if(origin.distanceToPoint(it.second.Position()) < 5.)
-        {
-            systemView->Select(&it.second);
-            tabs->setCurrentWidget(systemView);
-            return;
-        }
+    System *system = systemIndex.Nearest(MapPoint(event->pos()), 5.);
+    if(system)
+    {
+        systemView->Select(system);
+        tabs->setCurrentWidget(systemView);
+    }
 }
 
 
@@ -505,15 +831,29 @@ void GalaxyView::mouseMoveEvent(QMouseEvent *event)
         return;
 
     QVector2D distance = QVector2D(event->pos()) - clickOff;
-    if(!dragSystem)
+    if(isSelecting)
+        selectEnd = MapPoint(event->pos());
+    else if(!dragSystem)
         offset = distance;
     else
     {
         if(dragTime.elapsed() < 1000 && distance.length() < 5.)
             return;
 
-        dragSystem->SetPosition(dragSystem->Position() + distance / scale);
-        mapData.SetChanged();
+        // While a system is being dragged, the tiles are drawn without it, and
+        // it is drawn on top of them instead. That way, moving it does not
+        // change any of the tiles.
+        QVector2D from = dragSystem->Position();
+        if(renderer.Hidden() != dragSystem)
+        {
+            renderer.SetHidden(dragSystem);
+            MapChanged(MoveArea(*dragSystem, from));
+        }
+        dragSystem->SetPosition(from + distance / scale);
+        systemIndex.Move(dragSystem, from);
+        renderer.Extend(*dragSystem);
+        // The tiles do not change, but the map does.
+        MapChanged(QRectF());
         clickOff = QVector2D(event->pos());
     }
     update();
@@ -521,6 +861,28 @@ void GalaxyView::mouseMoveEvent(QMouseEvent *event)
 
 
 
+// Finish dragging a system, or selecting a rectangle of systems. A shift-click
+// without dragging clears the selection.
+void GalaxyView::mouseReleaseEvent(QMouseEvent *event)
+{
+    // If a system was being dragged, draw it into the tiles again.
+    if(dragSystem && renderer.Hidden() == dragSystem && event->button() == Qt::LeftButton)
+    {
+        renderer.SetHidden(nullptr);
+        MapChanged(MoveArea(*dragSystem, dragSystem->Position()));
+        update();
+    }
+    if(!isSelecting || event->button() != Qt::LeftButton)
+        return;
+
+    isSelecting = false;
+    selection.clear();
+    systemIndex.Rect(QRectF(selectStart.toPointF(), selectEnd.toPointF()), selection);
+    update();
+}
+
+
+
 // Zoom in or out.
 void GalaxyView::wheelEvent(QWheelEvent *event)
 {
@@ -529,7 +891,7 @@ void GalaxyView::wheelEvent(QWheelEvent *event)
     // point = origin * scale + offset + center.
     QVector2D origin = (point - offset - center) / scale;
 
-    scale = max(.0625, min(1., scale * exp(event->delta() * .001)));
+    scale = max(MIN_SCALE, min(1., scale * exp(event->delta() * .001)));
 
     // We want: point = origin * scale + offset + center.
     offset = point - origin * scale - center;
@@ -540,76 +902,67 @@ void GalaxyView::wheelEvent(QWheelEvent *event)
 
 void GalaxyView::paintEvent(QPaintEvent */*event*/)
 {
-    QPen blackPen;
     QPen mediumPen(QColor(120, 120, 120));
-    QPen brightPen(QColor(180, 180, 180));
 
     QPainter painter(this);
+    QPoint origin = Origin();
+    DrawTiles(painter, origin);
+
     painter.setRenderHint(QPainter::Antialiasing, true);
     painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
-
-    painter.translate(.5 * width(), .5 * height());
-    painter.translate(offset.x(), offset.y());
+    painter.translate(origin);
     painter.scale(scale, scale);
 
-    // Draw the "galaxy" images.
-    for(const Galaxy &it : mapData.Galaxies())
-    {
-        QPixmap sprite = SpriteSet::Get(it.Sprite());
-        QPointF pos = (it.Position() - QVector2D(.5 * sprite.width(), .5 * sprite.height())).toPointF();
-        painter.drawPixmap(pos, sprite);
-    }
+    // Only draw the overlays that are actually on the screen.
+    QRectF view(MapPoint(QPoint(0, 0)).toPointF(), MapPoint(QPoint(width(), height())).toPointF());
+    view.adjust(-10., -10., 10., 10.);
+    vector<System *> visible;
+    systemIndex.Rect(view, visible);
 
-    // Draw the links between systems.
-    painter.setBrush(Qt::NoBrush);
-    for(const auto &it : mapData.Systems())
+    // Draw any links that have been proposed but not accepted yet.
+    if(!proposedLinks.empty())
     {
-        QPointF pos = it.second.Position().toPointF();
-        for(const QString &link : it.second.Links())
+        QPen proposedPen(QColor(80, 220, 80));
+        proposedPen.setWidth(2);
+        proposedPen.setCosmetic(true);
+        painter.setPen(proposedPen);
+        QVector<QLineF> lines;
+        for(const pair<System *, System *> &link : proposedLinks)
         {
-            auto lit = mapData.Systems().find(link);
-            if(lit == mapData.Systems().end())
-                continue;
-
-            double value = 0.;
-            if(!commodity.isEmpty())
-            {
-                int difference = abs(it.second.Trade(commodity) - lit->second.Trade(commodity));
-                value = (difference - 60) / 60.;
-            }
-            else if(!government.isEmpty())
-                value = (it.second.Government() != lit->second.Government());
-            // Set the link color based on the "value".
-            QPen pen(value < 1. ? MapGrey(value) : QColor(255, 0, 0));
-            painter.setPen(pen);
-            painter.drawLine(pos, lit->second.Position().toPointF());
+            QPointF start = link.first->Position().toPointF();
+            QPointF end = link.second->Position().toPointF();
+            if(GalaxyRenderer::Intersects(view, start, end))
+                lines.append(QLineF(start, end));
         }
+        painter.drawLines(lines);
     }
 
-    // Draw the systems, colored by commodity or if the government is the selected government.
-    for(const auto &it : mapData.Systems())
+    // Suggest links to any unlinked systems within jump drive range of the
+    // selected system.
+    if(systemView && systemView->Selected())
     {
-        QPointF pos = it.second.Position().toPointF();
-        bool isSelected = (systemView && &it.second == systemView->Selected());
-        double value = 0.;
-        if(!commodity.isEmpty())
-            value = mapData.MapPrice(commodity, it.second.Trade(commodity)) * 2. - 1.;
-        else if(!government.isEmpty())
-            value = (it.second.Government() == government);
-        // Set the link color based on the "value".
-        QColor color = MapColor(value);
-        if(isSelected)
-            color.setRgbF(color.redF() * 1.5, color.greenF() * 1.5, color.blueF() * 1.5);
-        QBrush brush(color);
-        painter.setBrush(brush);
-        painter.setPen(blackPen);
-        painter.drawEllipse(pos, 5, 5);
-
-        painter.drawText(pos + QPointF(6, 6), it.first);
-        painter.setPen(brightPen);
-        painter.drawText(pos + QPointF(5, 5), it.first);
+        const System *selected = systemView->Selected();
+        QPen suggestionPen(QColor(90, 90, 90));
+        suggestionPen.setStyle(Qt::DashLine);
+        painter.setPen(suggestionPen);
+        vector<System *> nearby;
+        systemIndex.Radius(selected->Position(), 100., nearby);
+        QPointF start = selected->Position().toPointF();
+        for(const System *system : nearby)
+            if(system != selected && !selected->Links().count(system->Name())
+                    && GalaxyRenderer::Intersects(view, start, system->Position().toPointF()))
+                painter.drawLine(start, system->Position().toPointF());
     }
 
+    // The system that is being dragged is left out of the tiles.
+    const System *hidden = renderer.Hidden();
+    if(hidden)
+        renderer.DrawHidden(painter, view, scale, OneSidedLinks(*hidden));
+
+    // Draw the selected system again on top of the tiles, highlighted.
+    if(systemView && systemView->Selected())
+        renderer.DrawSystem(painter, *systemView->Selected(), true, view);
+
     // Draw the selection circle and neighbor radius ring.
     painter.setPen(mediumPen);
     painter.setBrush(Qt::NoBrush);
@@ -619,6 +972,163 @@ void GalaxyView::paintEvent(QPaintEvent */*event*/)
         painter.drawEllipse(pos, 10, 10);
         painter.drawEllipse(pos, 100, 100);
     }
+
+    // Draw the rectangle selection, and the systems it contains.
+    QPen selectionPen(QColor(120, 200, 255));
+    painter.setPen(selectionPen);
+    for(const System *system : selection)
+        if(view.contains(system->Position().toPointF()))
+            painter.drawEllipse(system->Position().toPointF(), 8, 8);
+    for(const System *system : visible)
+        if(pinned.count(system->Name()))
+            painter.drawRect(QRectF(system->Position().toPointF() - QPointF(8., 8.), QSizeF(16., 16.)));
+    if(isSelecting)
+        painter.drawRect(QRectF(selectStart.toPointF(), selectEnd.toPointF()).normalized());
+
+    if(showChokepoints)
+        DrawChokepoints(painter, view, visible);
+}
+
+
+
+// Get the point on the screen where map coordinate (0, 0) is, and the
+// columns and rows of the tiles that cover the screen.
+QPoint GalaxyView::Origin() const
+{
+    // Keep the view lined up with whole pixels, so that the cached tiles can
+    // be copied to the screen without being resampled.
+    return QPoint(round(.5 * width() + offset.x()), round(.5 * height() + offset.y()));
+}
+
+
+
+QRect GalaxyView::VisibleTiles(const QPoint &origin) const
+{
+    const double size = TileCache::TILE_SIZE;
+    int left = floor(-origin.x() / size);
+    int right = floor((width() - origin.x()) / size);
+    int top = floor(-origin.y() / size);
+    int bottom = floor((height() - origin.y()) / size);
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+
+
+// Draw the parts of the map that are cached in tiles.
+void GalaxyView::DrawTiles(QPainter &painter, const QPoint &origin)
+{
+    // Throw out all the tiles if the map has changed, or if it should now be
+    // colored differently.
+    GalaxyRenderer::Style style;
+    style.commodity = commodity;
+    style.government = government;
+    style.showNames = showNames;
+    if(showDistances && systemView && systemView->Selected())
+    {
+        style.origin = analysis.Graph().Index(systemView->Selected());
+        if(style.origin >= 0)
+        {
+            style.distances = &analysis.Distances();
+            style.graph = &analysis.Graph();
+        }
+    }
+    if(style != renderer.GetStyle() || tileRevision != mapData.Revision())
+    {
+        renderer.SetStyle(style);
+        renderer.Refresh();
+        tiles.Clear();
+        tileRevision = mapData.Revision();
+    }
+
+    // Draw the tiles that are already cached, and make a list of the ones
+    // that are not.
+    const int size = TileCache::TILE_SIZE;
+    QRect visible = VisibleTiles(origin);
+    vector<TileRenderer::Tile> missing;
+    for(int y = visible.top(); y <= visible.bottom(); ++y)
+        for(int x = visible.left(); x <= visible.right(); ++x)
+        {
+            const QImage *tile = tiles.Find(scale, x, y);
+            if(tile)
+                painter.drawImage(QPoint(origin.x() + x * size, origin.y() + y * size), *tile);
+            else
+            {
+                missing.emplace_back();
+                missing.back().x = x;
+                missing.back().y = y;
+            }
+        }
+    if(missing.empty())
+        return;
+
+    tileRenderer.Render(missing, scale);
+    for(const TileRenderer::Tile &tile : missing)
+    {
+        painter.drawImage(QPoint(origin.x() + tile.x * size, origin.y() + tile.y * size), tile.image);
+        tiles.Insert(scale, tile.x, tile.y, tile.image);
+    }
+}
+
+
+
+// Mark the map as changed, but only redraw the tiles in the given area. If
+// the area is null, nothing that is drawn in the tiles changed.
+void GalaxyView::MapChanged(const QRectF &area)
+{
+    // If there were other changes since the tiles were last checked, they
+    // will all have to be redrawn anyways.
+    bool isCurrent = (tileRevision == mapData.Revision());
+    mapData.SetChanged();
+    if(!area.isNull())
+        for(double tileScale : tiles.Scales())
+            tiles.Invalidate(renderer.ChangedArea(area, tileScale), tileScale);
+    if(isCurrent)
+        tileRevision = mapData.Revision();
+}
+
+
+
+// Get the area that needs to be redrawn after moving a system.
+QRectF GalaxyView::MoveArea(const System &system, const QVector2D &from)
+{
+    vector<const System *> linked;
+    for(const QString &name : system.Links())
+    {
+        auto it = mapData.Systems().find(name);
+        if(it != mapData.Systems().end())
+            linked.push_back(&it->second);
+    }
+    for(const System *other : OneSidedLinks(system))
+        linked.push_back(other);
+
+    QRectF area = renderer.SystemBounds(system, from).united(renderer.SystemBounds(system, system.Position()));
+    for(const System *other : linked)
+    {
+        QPointF end = other->Position().toPointF();
+        area = area.united(QRectF(from.toPointF(), end).normalized());
+        area = area.united(QRectF(system.Position().toPointF(), end).normalized());
+    }
+    return area.adjusted(-1., -1., 1., 1.);
+}
+
+
+
+// Get the systems that link to the given one, but that it does not link
+// back to, e.g. because it was added by a plugin.
+vector<System *> GalaxyView::OneSidedLinks(const System &system)
+{
+    vector<System *> result;
+    const LinkGraph &graph = analysis.Graph();
+    int index = graph.Index(&system);
+    if(index < 0)
+        return result;
+    for(int link : graph.LinksTo(index))
+    {
+        System *other = graph.GetSystem(link);
+        if(!system.Links().count(other->Name()))
+            result.push_back(other);
+    }
+    return result;
 }
 
 
@@ -646,7 +1156,8 @@ void GalaxyView::CreateSystem(const QVector2D &origin)
         else
         {
             System &system = mapData.Systems()[text];
-            system.Init(text, origin);
+            Random random = Random::Operation();
+            system.Init(text, origin, random);
             // If a previous system was selected, the new system extends from it.
             if(systemView && systemView->Selected())
             {
@@ -661,7 +1172,56 @@ void GalaxyView::CreateSystem(const QVector2D &origin)
             if(systemView)
                 systemView->Select(&system);
             mapData.SetChanged();
+            Reload();
             update();
         }
     }
 }
+
+
+
+// Circle every system that is cut off from the largest group of systems, and
+// highlight the links and systems that are the only way between two regions.
+void GalaxyView::DrawChokepoints(QPainter &painter, const QRectF &view, const vector<System *> &visible)
+{
+    const LinkGraph &graph = analysis.Graph();
+    const int largest = analysis.LargestComponentSize();
+
+    QPen bridgePen(QColor(255, 60, 60));
+    bridgePen.setWidth(3);
+    bridgePen.setCosmetic(true);
+    painter.setPen(bridgePen);
+    painter.setBrush(Qt::NoBrush);
+    QVector<QLineF> lines;
+    for(const pair<int, int> &bridge : analysis.Bridges())
+    {
+        QPointF start = graph.GetSystem(bridge.first)->Position().toPointF();
+        QPointF end = graph.GetSystem(bridge.second)->Position().toPointF();
+        if(GalaxyRenderer::Intersects(view, start, end))
+            lines.append(QLineF(start, end));
+    }
+    painter.drawLines(lines);
+
+    QPen isolatedPen(QColor(255, 160, 0));
+    isolatedPen.setWidth(2);
+    isolatedPen.setCosmetic(true);
+    painter.setPen(isolatedPen);
+    for(const System *system : visible)
+    {
+        int i = graph.Index(system);
+        if(i >= 0 && analysis.ComponentSize(i) < largest)
+            painter.drawEllipse(system->Position().toPointF(), 8, 8);
+    }
+
+    painter.setPen(bridgePen);
+    for(int i : analysis.ArticulationPoints())
+        if(view.contains(graph.GetSystem(i)->Position().toPointF()))
+            painter.drawEllipse(graph.GetSystem(i)->Position().toPointF(), 8, 8);
+
+    // Summarize the results in the corner of the view.
+    painter.resetTransform();
+    painter.setPen(QColor(180, 180, 180));
+    painter.drawText(QPointF(10., 20.), QString::number(analysis.ComponentCount()) + " groups of systems, "
+        + QString::number(analysis.Bridges().size()) + " chokepoint links, "
+        + QString::number(analysis.ArticulationPoints().size()) + " chokepoint systems");
+}
@@ -13,16 +13,32 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef GALAXYVIEW_H
 #define GALAXYVIEW_H
 
+#include "GalaxyRenderer.h"
+#include "LayoutRelaxer.h"
+#include "LinkAnalysis.h"
+#include "SpatialIndex.h"
+#include "TileCache.h"
+#include "TileRenderer.h"
+
 #include <QWidget>
 
 #include <QVector2D>
 #include <QElapsedTimer>
+#include <QImage>
+#include <QRect>
+#include <QRectF>
+#include <QTimer>
+
+#include <set>
+#include <utility>
+#include <vector>
 
 class DetailView;
 class Map;
 class System;
 class SystemView;
 
+class QPainter;
 class QPoint;
 class QTabWidget;
 
@@ -34,10 +50,16 @@ public:
     explicit GalaxyView(Map &mapData, QTabWidget *tabs, QWidget *parent = 0);
 
     void Center();
+    // Forget anything cached about the map, e.g. because systems were added,
+    // removed, or renamed, or a new map was loaded.
+    void Reload();
     void SetSystemView(SystemView *view);
     void SetDetailView(DetailView *view);
     void SetCommodity(const QString &name);
     void SetGovernment(const QString &name);
+    // Call this after changing a system's prices or government, so that only
+    // the parts of the map that look different are redrawn.
+    void SystemChanged(const System &system);
     void KeyPress(QKeyEvent *event);
 
 signals:
@@ -48,11 +70,26 @@ public slots:
     void DeleteSystem();
     void Recenter();
     void RandomizeCommodity();
+    void RandomizeAllCommodities();
+    void SmoothPrices();
+    void ProposeLinks();
+    void TogglePin();
+    void RelaxLayout();
+    void RegenerateSystems();
+    void CheckLayout();
+    void ToggleChokepoints();
+    void ToggleJumpDistances();
+    void ToggleNames();
+    void TimeDrawing();
+
+private slots:
+    void RelaxStep();
 
 protected:
     virtual void mousePressEvent(QMouseEvent *event) override;
     virtual void mouseDoubleClickEvent(QMouseEvent *event) override;
     virtual void mouseMoveEvent(QMouseEvent *event) override;
+    virtual void mouseReleaseEvent(QMouseEvent *event) override;
     virtual void wheelEvent(QWheelEvent *event) override;
 
     virtual void paintEvent(QPaintEvent *event) override;
@@ -60,6 +97,25 @@ protected:
 private:
     QVector2D MapPoint(QPoint pos) const;
     void CreateSystem(const QVector2D &origin);
+    // Draw the chokepoints inside the given view. The visible systems are the
+    // ones inside the view.
+    void DrawChokepoints(QPainter &painter, const QRectF &view, const std::vector<System *> &visible);
+
+    // Get the point on the screen where map coordinate (0, 0) is, and the
+    // columns and rows of the tiles that cover the screen.
+    QPoint Origin() const;
+    QRect VisibleTiles(const QPoint &origin) const;
+    // Draw the parts of the map that are cached in tiles. Any tiles that are
+    // not cached are drawn in parallel.
+    void DrawTiles(QPainter &painter, const QPoint &origin);
+    // Mark the map as changed, but only redraw the tiles in the given area. If
+    // the area is null, nothing that is drawn in the tiles changed.
+    void MapChanged(const QRectF &area);
+    // Get the area that needs to be redrawn after moving a system.
+    QRectF MoveArea(const System &system, const QVector2D &from);
+    // Get the systems that link to the given one, but that it does not link
+    // back to, e.g. because it was added by a plugin.
+    std::vector<System *> OneSidedLinks(const System &system);
 
 
 private:
@@ -77,9 +133,39 @@ private:
     System *dragSystem = nullptr;
     QElapsedTimer dragTime;
 
+    // Shift-dragging on the background selects every system in a rectangle.
+    bool isSelecting = false;
+    QVector2D selectStart;
+    QVector2D selectEnd;
+    std::vector<System *> selection;
+
+    // Links that have been proposed, but not yet accepted.
+    std::vector<std::pair<System *, System *>> proposedLinks;
+
+    // Relaxing the layout of the selected systems. Pinned systems never move.
+    std::set<QString> pinned;
+    LayoutRelaxer relaxer;
+    QTimer relaxTimer;
+
+    // Everything but the selection and other overlays is drawn into cached
+    // tiles, which are thrown out if the map changes.
+    GalaxyRenderer renderer;
+    TileRenderer tileRenderer;
+    TileCache tiles;
+    int tileRevision = -1;
+
     // Color systems by:
     QString commodity;
     QString government;
+    bool showDistances = false;
+    bool showNames = true;
+
+    // Groups of linked systems and chokepoints, kept up to date as links are
+    // edited so they can be drawn over the map.
+    LinkAnalysis analysis;
+    bool showChokepoints = false;
+    // Grid of system positions, for hit tests and finding nearby systems.
+    SpatialIndex systemIndex;
 };
 
 
@@ -0,0 +1,82 @@
+/* JumpDistances.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "JumpDistances.h"
+
+#include "LinkGraph.h"
+
+#include <QtConcurrent>
+
+using namespace std;
+
+namespace {
+    static const uint8_t UNREACHABLE = 255;
+}
+
+
+
+// Find the distance between every pair of systems in the given graph.
+void JumpDistances::Build(const LinkGraph &graph)
+{
+    size = graph.Size();
+    table.assign(static_cast<size_t>(size) * size, UNREACHABLE);
+
+    // Each search only writes to its own row of the table.
+    vector<int> rows(size);
+    for(int i = 0; i < size; ++i)
+        rows[i] = i;
+    QtConcurrent::blockingMap(rows, [this, &graph](int start)
+    {
+        uint8_t *row = &table[static_cast<size_t>(start) * size];
+        vector<int> queue;
+        queue.reserve(size);
+        queue.push_back(start);
+        row[start] = 0;
+        for(size_t i = 0; i < queue.size(); ++i)
+        {
+            int system = queue[i];
+            if(row[system] >= MAX)
+                break;
+            for(int link : graph.Links(system))
+                if(row[link] == UNREACHABLE)
+                {
+                    row[link] = row[system] + 1;
+                    queue.push_back(link);
+                }
+        }
+    });
+}
+
+
+
+void JumpDistances::Clear()
+{
+    size = 0;
+    table.clear();
+}
+
+
+
+int JumpDistances::Size() const
+{
+    return size;
+}
+
+
+
+// Get the number of jumps it takes to get from one system to another, or
+// -1 if there is no route (of at most MAX jumps) between them.
+int JumpDistances::Distance(int from, int to) const
+{
+    uint8_t distance = table[static_cast<size_t>(from) * size + to];
+    return (distance == UNREACHABLE) ? -1 : distance;
+}
@@ -0,0 +1,54 @@
+/* JumpDistances.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef JUMPDISTANCES_H
+#define JUMPDISTANCES_H
+
+#include <cstdint>
+#include <vector>
+
+class LinkGraph;
+
+
+
+// Class holding the number of jumps between every pair of systems, so that
+// looking one up is just an array access. Each count is stored in one byte,
+// so a map with a thousand systems only needs a megabyte. The table is filled
+// in by a breadth-first search from every system, with the searches spread
+// across all the available cores. Systems that are farther apart than a byte
+// can count are treated as unreachable.
+class JumpDistances {
+public:
+    // The most jumps that can be stored.
+    static const int MAX = 254;
+
+
+public:
+    // Find the distance between every pair of systems in the given graph.
+    void Build(const LinkGraph &graph);
+    void Clear();
+
+    int Size() const;
+    // Get the number of jumps it takes to get from one system to another, or
+    // -1 if there is no route (of at most MAX jumps) between them.
+    int Distance(int from, int to) const;
+
+
+private:
+    int size = 0;
+    // Row i holds the distances from system i.
+    std::vector<uint8_t> table;
+};
+
+
+
+#endif // JUMPDISTANCES_H
@@ -0,0 +1,348 @@
+/* LayoutRelaxer.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "LayoutRelaxer.h"
+
+#include "Map.h"
+#include "System.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+
+using namespace std;
+
+namespace {
+    // Each step, the most any system can move shrinks by this factor, so the
+    // layout settles down instead of oscillating.
+    static const double COOLING = .98;
+    // Stop once no system moves more than this in one step.
+    static const double SETTLED = .05;
+    // Stop splitting quadtree nodes below this depth. Only systems in almost
+    // exactly the same place will ever get this deep.
+    static const int MAX_DEPTH = 24;
+    // Links only pull their ends together if they are longer than this many
+    // link lengths. Systems that do not move are only included if they are
+    // within this many link lengths of the moving ones, which may drift a
+    // little way from where they started.
+    static const double RANGE = 2.;
+}
+
+
+
+// Start relaxing the given systems. Any systems in the map that are not in
+// the list (or are in the list but pinned) will not move.
+void LayoutRelaxer::Start(Map &map, const vector<System *> &systems, const vector<System *> &pinned, const Options &options)
+{
+    Stop();
+    this->options = options;
+    temperature = .5 * options.linkLength;
+
+    // The moving systems go first in the list of bodies.
+    set<const System *> isPinned(pinned.begin(), pinned.end());
+    set<const System *> isMoving;
+    for(System *system : systems)
+        if(!isPinned.count(system) && isMoving.insert(system).second)
+            bodies.push_back(system);
+    moving = static_cast<int>(bodies.size());
+    if(!moving)
+        return;
+
+    // Systems far from all the moving ones cannot push on them, so leave them
+    // out, unless they are linked to one.
+    double left = bodies.front()->Position().x();
+    double top = bodies.front()->Position().y();
+    double right = left;
+    double bottom = top;
+    set<QString> linked;
+    for(int i = 0; i < moving; ++i)
+    {
+        const QVector2D &pos = bodies[i]->Position();
+        left = min<double>(left, pos.x());
+        top = min<double>(top, pos.y());
+        right = max<double>(right, pos.x());
+        bottom = max<double>(bottom, pos.y());
+        linked.insert(bodies[i]->Links().begin(), bodies[i]->Links().end());
+    }
+    double margin = RANGE * options.linkLength;
+    for(auto &it : map.Systems())
+    {
+        if(isMoving.count(&it.second))
+            continue;
+        const QVector2D &pos = it.second.Position();
+        bool isNear = (pos.x() >= left - margin && pos.x() <= right + margin
+            && pos.y() >= top - margin && pos.y() <= bottom + margin);
+        if(isNear || linked.count(it.first))
+            bodies.push_back(&it.second);
+    }
+
+    std::map<QString, int> index;
+    for(unsigned i = 0; i < bodies.size(); ++i)
+    {
+        index[bodies[i]->Name()] = i;
+        x.push_back(bodies[i]->Position().x());
+        y.push_back(bodies[i]->Position().y());
+    }
+
+    // Only links that touch a moving system matter. If both ends are moving,
+    // only add the link once.
+    for(int i = 0; i < moving; ++i)
+        for(const QString &name : bodies[i]->Links())
+        {
+            auto it = index.find(name);
+            if(it != index.end() && it->second != i && (it->second >= moving || it->second > i))
+                springs.emplace_back(i, it->second);
+        }
+
+    movingSystems.assign(bodies.begin(), bodies.begin() + moving);
+    previous.resize(moving);
+}
+
+
+
+void LayoutRelaxer::Stop()
+{
+    steps = 0;
+    bodies.clear();
+    x.clear();
+    y.clear();
+    moving = 0;
+    springs.clear();
+    tree.clear();
+    movingSystems.clear();
+    previous.clear();
+}
+
+
+
+bool LayoutRelaxer::IsActive() const
+{
+    return moving > 0;
+}
+
+
+
+// Take one step of the simulation and move the systems to their new
+// positions. Returns false once the systems have settled (or the step
+// limit is reached), at which point the relaxation stops.
+bool LayoutRelaxer::Step()
+{
+    if(!IsActive())
+        return false;
+
+    const double length = options.linkLength;
+    vector<double> fx(moving, 0.);
+    vector<double> fy(moving, 0.);
+
+    // A link pushes its ends apart if they are closer than the ideal link
+    // length, and pulls them together if they are more than twice that far
+    // apart. Anywhere in between is a comfortable distance, so a layout that is
+    // not crowded is left alone.
+    for(const pair<int, int> &spring : springs)
+    {
+        double dx = x[spring.second] - x[spring.first];
+        double dy = y[spring.second] - y[spring.first];
+        double d = sqrt(dx * dx + dy * dy);
+        if(!d)
+            continue;
+        double stretch = (d < length) ? d - length : max(0., d - RANGE * length);
+        double force = stretch / d;
+        fx[spring.first] += force * dx;
+        fy[spring.first] += force * dy;
+        if(spring.second < moving)
+        {
+            fx[spring.second] -= force * dx;
+            fy[spring.second] -= force * dy;
+        }
+    }
+
+    // Systems that are too close together push each other away.
+    BuildTree();
+    for(int i = 0; i < moving; ++i)
+        AddRepulsion(0, i, fx[i], fy[i]);
+
+    // Move each system in the direction of the force on it, but never by more
+    // than the current "temperature."
+    double largest = 0.;
+    for(int i = 0; i < moving; ++i)
+    {
+        double force = sqrt(fx[i] * fx[i] + fy[i] * fy[i]);
+        if(!force)
+            continue;
+        double distance = min(force, temperature);
+        x[i] += fx[i] * distance / force;
+        y[i] += fy[i] * distance / force;
+        largest = max(largest, distance);
+    }
+    temperature *= COOLING;
+
+    for(int i = 0; i < moving; ++i)
+    {
+        previous[i] = bodies[i]->Position();
+        bodies[i]->SetPosition(QVector2D(x[i], y[i]));
+    }
+
+    if(largest < SETTLED || ++steps >= options.maxSteps)
+    {
+        // Keep the list of moved systems until the next Start(), so the caller
+        // can still see what moved in this last step.
+        bodies.clear();
+        moving = 0;
+        return false;
+    }
+    return true;
+}
+
+
+
+// The systems that are moving, and the positions they were in before the
+// last step.
+const vector<System *> &LayoutRelaxer::Moving() const
+{
+    return movingSystems;
+}
+
+
+
+const vector<QVector2D> &LayoutRelaxer::Previous() const
+{
+    return previous;
+}
+
+
+
+void LayoutRelaxer::BuildTree()
+{
+    tree.clear();
+    order.resize(bodies.size());
+    for(unsigned i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    double left = *min_element(x.begin(), x.end());
+    double right = *max_element(x.begin(), x.end());
+    double top = *min_element(y.begin(), y.end());
+    double bottom = *max_element(y.begin(), y.end());
+    double size = max(1., max(right - left, bottom - top));
+    BuildNode(0, static_cast<int>(order.size()), left, top, size, 0);
+}
+
+
+
+int LayoutRelaxer::BuildNode(int begin, int end, double left, double top, double size, int depth)
+{
+    int index = static_cast<int>(tree.size());
+    tree.emplace_back();
+    tree[index].left = left;
+    tree[index].top = top;
+    tree[index].size = size;
+
+    if(end - begin == 1 || depth >= MAX_DEPTH)
+    {
+        Node &node = tree[index];
+        node.body = (end - begin == 1) ? order[begin] : -2;
+        for(int i = begin; i < end; ++i)
+        {
+            node.x += x[order[i]];
+            node.y += y[order[i]];
+        }
+        node.mass = end - begin;
+        node.x /= node.mass;
+        node.y /= node.mass;
+        return index;
+    }
+
+    // Sort the systems into the four quadrants: top left, top right, bottom
+    // left, bottom right.
+    double half = .5 * size;
+    double midX = left + half;
+    double midY = top + half;
+    auto first = order.begin();
+    int split[5];
+    split[0] = begin;
+    split[4] = end;
+    split[2] = static_cast<int>(partition(first + begin, first + end, [this, midY](int i) { return y[i] < midY; }) - first);
+    split[1] = static_cast<int>(partition(first + begin, first + split[2], [this, midX](int i) { return x[i] < midX; }) - first);
+    split[3] = static_cast<int>(partition(first + split[2], first + end, [this, midX](int i) { return x[i] < midX; }) - first);
+
+    double mass = 0.;
+    double sumX = 0.;
+    double sumY = 0.;
+    for(int q = 0; q < 4; ++q)
+    {
+        if(split[q] == split[q + 1])
+            continue;
+        int child = BuildNode(split[q], split[q + 1], left + (q & 1) * half, top + (q >> 1) * half, half, depth + 1);
+        // Building the child may have reallocated the tree.
+        tree[index].child[q] = child;
+        const Node &node = tree[child];
+        mass += node.mass;
+        sumX += node.mass * node.x;
+        sumY += node.mass * node.y;
+    }
+    Node &node = tree[index];
+    node.mass = mass;
+    node.x = sumX / mass;
+    node.y = sumY / mass;
+    return index;
+}
+
+
+
+void LayoutRelaxer::AddRepulsion(int index, int body, double &fx, double &fy) const
+{
+    const Node &node = tree[index];
+    if(node.body == body)
+        return;
+
+    // Systems only push each other if they are closer than one link length,
+    // so nothing in this node matters if all of it is farther away than that.
+    const double length = options.linkLength;
+    double outsideX = max(0., max(node.left - x[body], x[body] - (node.left + node.size)));
+    double outsideY = max(0., max(node.top - y[body], y[body] - (node.top + node.size)));
+    if(outsideX * outsideX + outsideY * outsideY >= length * length)
+        return;
+
+    double dx = x[body] - node.x;
+    double dy = y[body] - node.y;
+    double d2 = dx * dx + dy * dy;
+    bool isLeaf = (node.body != -1);
+    if(!isLeaf && node.size * node.size >= options.theta * options.theta * d2)
+    {
+        for(int child : node.child)
+            if(child >= 0)
+                AddRepulsion(child, body, fx, fy);
+        return;
+    }
+
+    // Systems in exactly the same place need some direction to move apart in.
+    // Pick one based on the system's index, so they all go different ways.
+    if(d2 < 1e-6)
+    {
+        double angle = body * 2.39996;
+        fx += length * node.mass * cos(angle);
+        fy += length * node.mass * sin(angle);
+        return;
+    }
+    // The push falls off with the square of the distance, and drops to zero
+    // once the systems are one link length apart, so systems that are already
+    // spread out do not push each other any farther. At half a link length,
+    // it is as strong as the pull of a link stretched to two and a half times
+    // its length. Any stronger, and systems tend to overshoot and bounce back
+    // and forth instead of settling.
+    double length2 = length * length;
+    if(d2 >= length2)
+        return;
+    double scale = node.mass * .5 * length * (length2 / d2 - 1.) / sqrt(d2);
+    fx += scale * dx;
+    fy += scale * dy;
+}
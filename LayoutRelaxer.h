@@ -0,0 +1,107 @@
+/* LayoutRelaxer.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef LAYOUTRELAXER_H
+#define LAYOUTRELAXER_H
+
+#include <QVector2D>
+
+#include <utility>
+#include <vector>
+
+class Map;
+class System;
+
+
+
+// Class for spreading out a group of systems that are too close together,
+// while keeping linked systems a reasonable distance apart. Systems that are
+// closer than one link length push each other away, and each link acts as a
+// spring that goes slack once it is a comfortable length. Only the systems
+// being relaxed move; all the others nearby stay in place but still push on
+// them. To avoid adding up the push from every pair of systems, distant groups
+// of systems are treated as a single heavy system at their center of mass,
+// using a quadtree (the Barnes-Hut approximation).
+class LayoutRelaxer {
+public:
+    struct Options {
+        // The distance that systems try to keep between them. Linked systems
+        // are only pulled together if they are more than twice this far apart.
+        double linkLength = 70.;
+        // How far away a group of systems must be, relative to its size, to
+        // treat it as a single system. Smaller is more accurate.
+        double theta = .8;
+        // The most steps to take before stopping.
+        int maxSteps = 300;
+    };
+
+
+public:
+    // Start relaxing the given systems. Any systems in the map that are not in
+    // the list (or are in the list but pinned) will not move.
+    void Start(Map &map, const std::vector<System *> &systems, const std::vector<System *> &pinned, const Options &options);
+    void Stop();
+    bool IsActive() const;
+
+    // Take one step of the simulation and move the systems to their new
+    // positions. Returns false once the systems have settled (or the step
+    // limit is reached), at which point the relaxation stops.
+    bool Step();
+
+    // The systems that are moving, and the positions they were in before the
+    // last step.
+    const std::vector<System *> &Moving() const;
+    const std::vector<QVector2D> &Previous() const;
+
+
+private:
+    // A node of the quadtree. A leaf holds one system (or, if several are in
+    // exactly the same place, all of them).
+    struct Node {
+        double x = 0.;
+        double y = 0.;
+        double mass = 0.;
+        double left = 0.;
+        double top = 0.;
+        double size = 0.;
+        int child[4] = {-1, -1, -1, -1};
+        int body = -1;
+    };
+
+    void BuildTree();
+    int BuildNode(int begin, int end, double left, double top, double size, int depth);
+    void AddRepulsion(int node, int body, double &fx, double &fy) const;
+
+
+private:
+    Options options;
+    int steps = 0;
+    double temperature = 0.;
+
+    // All the systems. The first "moving" of them can move.
+    std::vector<System *> bodies;
+    std::vector<double> x;
+    std::vector<double> y;
+    int moving = 0;
+    // Links, as pairs of indices into the body list.
+    std::vector<std::pair<int, int>> springs;
+
+    std::vector<Node> tree;
+    std::vector<int> order;
+
+    std::vector<System *> movingSystems;
+    std::vector<QVector2D> previous;
+};
+
+
+
+#endif // LAYOUTRELAXER_H
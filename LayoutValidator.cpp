@@ -0,0 +1,52 @@
+/* LayoutValidator.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "LayoutValidator.h"
+
+#include "Map.h"
+#include "System.h"
+
+#include <QtConcurrent>
+
+using namespace std;
+
+namespace {
+    struct Job {
+        const System *system;
+        vector<QString> problems;
+    };
+}
+
+
+
+// Check every system in the given map, and return each problem found,
+// along with the system that it is in, sorted by system name and then by
+// object.
+vector<pair<const System *, QString>> LayoutValidator::Check(const Map &map)
+{
+    // The map's systems are already sorted by name, so keeping the jobs in the
+    // same order means the results need no further sorting.
+    vector<Job> jobs;
+    for(const auto &it : map.Systems())
+        jobs.push_back({&it.second, vector<QString>()});
+
+    QtConcurrent::blockingMap(jobs, [](Job &job)
+    {
+        job.system->CheckLayout(job.problems);
+    });
+
+    vector<pair<const System *, QString>> report;
+    for(const Job &job : jobs)
+        for(const QString &problem : job.problems)
+            report.emplace_back(job.system, problem);
+    return report;
+}
@@ -0,0 +1,41 @@
+/* LayoutValidator.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef LAYOUTVALIDATOR_H
+#define LAYOUTVALIDATOR_H
+
+#include <QString>
+
+#include <utility>
+#include <vector>
+
+class Map;
+class System;
+
+
+
+// Class for checking the stellar object layout of every system in a map. The
+// interactive editing functions keep each system valid, but hand-edited or
+// generated map files may break the spacing rules, so this finds every system
+// that does. The systems are independent of each other, so they are all
+// checked in parallel.
+class LayoutValidator {
+public:
+    // Check every system in the given map, and return each problem found,
+    // along with the system that it is in, sorted by system name and then by
+    // object.
+    static std::vector<std::pair<const System *, QString>> Check(const Map &map);
+};
+
+
+
+#endif // LAYOUTVALIDATOR_H
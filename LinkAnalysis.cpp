@@ -0,0 +1,327 @@
+/* LinkAnalysis.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "LinkAnalysis.h"
+
+#include "Map.h"
+#include "System.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+
+// Analyze the given map. The analysis keeps a pointer to it, so that it
+// can bring itself up to date after links are changed.
+void LinkAnalysis::Build(Map &map)
+{
+    this->map = &map;
+    Invalidate();
+    Update();
+}
+
+
+
+// Forget everything, e.g. because systems were added, removed, or renamed.
+// The analysis is rebuilt the next time it is used.
+void LinkAnalysis::Invalidate()
+{
+    hasSystems = false;
+    hasLinks = false;
+    hasComponents = false;
+    hasChokepoints = false;
+    hasDistances = false;
+}
+
+
+
+// Call this after the link between the given systems was toggled.
+void LinkAnalysis::ToggleLink(const System *first, const System *second)
+{
+    if(!hasSystems || !first || !second)
+        return;
+
+    // The set of systems has not changed, so the indices are still good, but
+    // the graph's list of links is not.
+    int a = graph.Index(first);
+    int b = graph.Index(second);
+    hasLinks = false;
+    if(a < 0 || b < 0)
+    {
+        Invalidate();
+        return;
+    }
+
+    if(first->Links().count(second->Name()))
+    {
+        // A new link can only merge two groups.
+        if(hasComponents)
+            Union(a, b);
+    }
+    else if(!hasChokepoints || IsBridge(a, b))
+    {
+        // Removing a bridge splits a group. Otherwise, the two systems are
+        // still connected some other way, so the groups stay the same.
+        hasComponents = false;
+    }
+    hasChokepoints = false;
+    hasDistances = false;
+}
+
+
+
+// The graph that all the indices refer to.
+const LinkGraph &LinkAnalysis::Graph()
+{
+    Update();
+    return graph;
+}
+
+
+
+// Get the group that a system belongs to, as the index of one of the
+// systems in that group.
+int LinkAnalysis::Component(int index)
+{
+    Update();
+    // Path halving: point each system visited at its grandparent.
+    while(parent[index] != index)
+    {
+        parent[index] = parent[parent[index]];
+        index = parent[index];
+    }
+    return index;
+}
+
+
+
+int LinkAnalysis::ComponentSize(int index)
+{
+    return size[Component(index)];
+}
+
+
+
+int LinkAnalysis::ComponentCount()
+{
+    Update();
+    return componentCount;
+}
+
+
+
+int LinkAnalysis::LargestComponentSize()
+{
+    Update();
+    return largest;
+}
+
+
+
+// Get the links whose removal would split a group, with the lower index
+// first, and the systems whose removal would split a group.
+const vector<pair<int, int>> &LinkAnalysis::Bridges()
+{
+    Update();
+    if(!hasChokepoints)
+        FindChokepoints();
+    return bridges;
+}
+
+
+
+const vector<int> &LinkAnalysis::ArticulationPoints()
+{
+    Update();
+    if(!hasChokepoints)
+        FindChokepoints();
+    return articulationPoints;
+}
+
+
+
+// Get the number of jumps between any two systems. Any change to the links
+// discards the table, and it is built again the next time it is needed.
+const JumpDistances &LinkAnalysis::Distances()
+{
+    Update();
+    if(!hasDistances)
+    {
+        distances.Build(graph);
+        hasDistances = true;
+    }
+    return distances;
+}
+
+
+
+// Make sure the graph and groups match the map.
+void LinkAnalysis::Update()
+{
+    if(!map)
+        return;
+    // If systems were added or removed without telling the analysis, the
+    // indices are no longer good for anything.
+    if(hasSystems && static_cast<size_t>(graph.Size()) != map->Systems().size())
+        Invalidate();
+    if(!hasSystems || !hasLinks)
+    {
+        graph.Build(*map);
+        hasSystems = true;
+        hasLinks = true;
+    }
+    if(!hasComponents || static_cast<int>(parent.size()) != graph.Size())
+        FindComponents();
+}
+
+
+
+void LinkAnalysis::FindComponents()
+{
+    const int count = graph.Size();
+    parent.resize(count);
+    size.assign(count, 1);
+    for(int i = 0; i < count; ++i)
+        parent[i] = i;
+    componentCount = count;
+    largest = count ? 1 : 0;
+
+    for(int i = 0; i < count; ++i)
+        for(int link : graph.Links(i))
+            Union(i, link);
+    hasComponents = true;
+}
+
+
+
+// Find the bridges and articulation points using Tarjan's algorithm. The
+// depth-first search keeps its own stack, because a long chain of systems
+// could overflow the call stack.
+void LinkAnalysis::FindChokepoints()
+{
+    bridges.clear();
+    articulationPoints.clear();
+    const int count = graph.Size();
+
+    // Links may be one-way (e.g. to or from a system that was edited by hand),
+    // so first make a list of each system's neighbors in both directions.
+    vector<pair<int, int>> edges;
+    for(int i = 0; i < count; ++i)
+        for(int link : graph.Links(i))
+            if(link != i)
+                edges.emplace_back(min(i, link), max(i, link));
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+
+    vector<int> offsets(count + 1, 0);
+    for(const pair<int, int> &edge : edges)
+    {
+        ++offsets[edge.first + 1];
+        ++offsets[edge.second + 1];
+    }
+    for(int i = 0; i < count; ++i)
+        offsets[i + 1] += offsets[i];
+    vector<int> next(offsets.begin(), offsets.end() - 1);
+    vector<int> neighbors(2 * edges.size());
+    for(const pair<int, int> &edge : edges)
+    {
+        neighbors[next[edge.first]++] = edge.second;
+        neighbors[next[edge.second]++] = edge.first;
+    }
+
+    // The order each system was found in, and the earliest system reachable
+    // from its subtree without going back through its parent.
+    vector<int> found(count, -1);
+    vector<int> low(count, 0);
+    vector<int> from(count, -1);
+    vector<char> isArticulation(count, 0);
+    vector<int> stack;
+    int time = 0;
+    for(int root = 0; root < count; ++root)
+    {
+        if(found[root] >= 0)
+            continue;
+
+        int rootChildren = 0;
+        found[root] = low[root] = time++;
+        next[root] = offsets[root];
+        stack.push_back(root);
+        while(!stack.empty())
+        {
+            int system = stack.back();
+            if(next[system] < offsets[system + 1])
+            {
+                int neighbor = neighbors[next[system]++];
+                if(found[neighbor] < 0)
+                {
+                    from[neighbor] = system;
+                    found[neighbor] = low[neighbor] = time++;
+                    next[neighbor] = offsets[neighbor];
+                    stack.push_back(neighbor);
+                    if(system == root)
+                        ++rootChildren;
+                }
+                else if(neighbor != from[system])
+                    low[system] = min(low[system], found[neighbor]);
+                continue;
+            }
+
+            // Done with this system, so pass its result back to its parent.
+            stack.pop_back();
+            int up = from[system];
+            if(up < 0)
+                continue;
+            low[up] = min(low[up], low[system]);
+            if(low[system] > found[up])
+                bridges.emplace_back(min(up, system), max(up, system));
+            if(up != root && low[system] >= found[up])
+                isArticulation[up] = 1;
+        }
+        if(rootChildren > 1)
+            isArticulation[root] = 1;
+    }
+
+    sort(bridges.begin(), bridges.end());
+    for(int i = 0; i < count; ++i)
+        if(isArticulation[i])
+            articulationPoints.push_back(i);
+    hasChokepoints = true;
+}
+
+
+
+bool LinkAnalysis::IsBridge(int first, int second) const
+{
+    return binary_search(bridges.begin(), bridges.end(), make_pair(min(first, second), max(first, second)));
+}
+
+
+
+// Merge the groups of the two given systems, attaching the smaller group
+// to the larger one.
+void LinkAnalysis::Union(int first, int second)
+{
+    while(parent[first] != first)
+        first = parent[first] = parent[parent[first]];
+    while(parent[second] != second)
+        second = parent[second] = parent[parent[second]];
+    if(first == second)
+        return;
+
+    if(size[first] < size[second])
+        swap(first, second);
+    parent[second] = first;
+    size[first] += size[second];
+    largest = max(largest, size[first]);
+    --componentCount;
+}
@@ -0,0 +1,100 @@
+/* LinkAnalysis.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef LINKANALYSIS_H
+#define LINKANALYSIS_H
+
+#include "JumpDistances.h"
+#include "LinkGraph.h"
+
+#include <utility>
+#include <vector>
+
+class Map;
+class System;
+
+
+
+// Class for finding out how well connected the map's hyperspace links are:
+// which groups of systems are cut off from each other, and which links and
+// systems are "chokepoints" that would split a group in two if removed. Links
+// are treated as going both ways. The groups are kept in a union-find
+// structure, so adding a link only has to merge two groups, and removing a
+// link that is not a chokepoint changes nothing. The chokepoints themselves are
+// only found when they are asked for, as is the table of jump distances between
+// systems. Systems are identified by their index in the link graph.
+class LinkAnalysis {
+public:
+    // Analyze the given map. The analysis keeps a pointer to it, so that it
+    // can bring itself up to date after links are changed.
+    void Build(Map &map);
+    // Forget everything, e.g. because systems were added, removed, or renamed.
+    // The analysis is rebuilt the next time it is used.
+    void Invalidate();
+    // Call this after the link between the given systems was toggled.
+    void ToggleLink(const System *first, const System *second);
+
+    // The graph that all the indices refer to.
+    const LinkGraph &Graph();
+
+    // Get the group that a system belongs to, as the index of one of the
+    // systems in that group.
+    int Component(int index);
+    int ComponentSize(int index);
+    int ComponentCount();
+    int LargestComponentSize();
+
+    // Get the links whose removal would split a group, with the lower index
+    // first, and the systems whose removal would split a group.
+    const std::vector<std::pair<int, int>> &Bridges();
+    const std::vector<int> &ArticulationPoints();
+
+    // Get the number of jumps between any two systems. Any change to the links
+    // discards the table, and it is built again the next time it is needed.
+    const JumpDistances &Distances();
+
+
+private:
+    // Make sure the graph and groups match the map.
+    void Update();
+    void FindComponents();
+    void FindChokepoints();
+    bool IsBridge(int first, int second) const;
+    void Union(int first, int second);
+
+
+private:
+    Map *map = nullptr;
+    LinkGraph graph;
+    // Whether the graph has the map's current systems, and current links.
+    bool hasSystems = false;
+    bool hasLinks = false;
+    bool hasComponents = false;
+    bool hasChokepoints = false;
+    bool hasDistances = false;
+
+    // Union-find over the systems. The size is only valid for a root.
+    std::vector<int> parent;
+    std::vector<int> size;
+    int componentCount = 0;
+    int largest = 0;
+
+    // Chokepoints found the last time the graph was analyzed.
+    std::vector<std::pair<int, int>> bridges;
+    std::vector<int> articulationPoints;
+
+    JumpDistances distances;
+};
+
+
+
+#endif // LINKANALYSIS_H
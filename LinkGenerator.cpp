@@ -0,0 +1,345 @@
+/* LinkGenerator.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "LinkGenerator.h"
+
+#include "System.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+namespace {
+    // A triangle in the triangulation, with its corners in counterclockwise
+    // order. The neighbor across the edge opposite corner i is neighbor[i], or
+    // -1 if that edge is on the outside.
+    struct Triangle {
+        int corner[3];
+        int neighbor[3];
+        bool isAlive;
+    };
+
+    // Twice the signed area of the triangle abc: positive if counterclockwise.
+    double Orient(const QVector2D &a, const QVector2D &b, const QVector2D &c)
+    {
+        return (static_cast<double>(b.x()) - a.x()) * (static_cast<double>(c.y()) - a.y())
+            - (static_cast<double>(b.y()) - a.y()) * (static_cast<double>(c.x()) - a.x());
+    }
+
+    // Check if point d is inside the circle through the counterclockwise
+    // triangle abc.
+    bool InCircle(const QVector2D &a, const QVector2D &b, const QVector2D &c, const QVector2D &d)
+    {
+        double ax = static_cast<double>(a.x()) - d.x(), ay = static_cast<double>(a.y()) - d.y();
+        double bx = static_cast<double>(b.x()) - d.x(), by = static_cast<double>(b.y()) - d.y();
+        double cx = static_cast<double>(c.x()) - d.x(), cy = static_cast<double>(c.y()) - d.y();
+        return (ax * ax + ay * ay) * (bx * cy - cx * by)
+            - (bx * bx + by * by) * (ax * cy - cx * ay)
+            + (cx * cx + cy * cy) * (ax * by - bx * ay) > 0.;
+    }
+
+    // A uniform grid of points, for checking whether any other point is near
+    // a proposed link.
+    class PointGrid {
+    public:
+        PointGrid(const vector<QVector2D> &points, double cellSize)
+            : points(points), cellSize(cellSize)
+        {
+            for(unsigned i = 0; i < points.size(); ++i)
+                cells[Key(Cell(points[i].x()), Cell(points[i].y()))].push_back(i);
+        }
+
+        // Check if any point other than a and b is inside the circle with the
+        // given center and radius and satisfies the given test.
+        template <class F>
+        bool Any(const QVector2D &center, double radius, int a, int b, F test) const
+        {
+            int left = Cell(center.x() - radius);
+            int right = Cell(center.x() + radius);
+            int top = Cell(center.y() - radius);
+            int bottom = Cell(center.y() + radius);
+            for(int y = top; y <= bottom; ++y)
+                for(int x = left; x <= right; ++x)
+                {
+                    auto it = cells.find(Key(x, y));
+                    if(it == cells.end())
+                        continue;
+                    for(int i : it->second)
+                        if(i != a && i != b && test(points[i]))
+                            return true;
+                }
+            return false;
+        }
+
+    private:
+        int Cell(double coordinate) const
+        {
+            return static_cast<int>(floor(coordinate / cellSize));
+        }
+        static int64_t Key(int x, int y)
+        {
+            return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y));
+        }
+
+    private:
+        const vector<QVector2D> &points;
+        double cellSize;
+        unordered_map<int64_t, vector<int>> cells;
+    };
+}
+
+
+
+// Propose links between the given systems, leaving out any that already
+// exist. Each pair of systems is listed once.
+vector<pair<System *, System *>> LinkGenerator::Propose(const vector<System *> &systems, const Options &options)
+{
+    vector<pair<System *, System *>> result;
+    vector<QVector2D> points;
+    for(const System *system : systems)
+        points.push_back(system->Position());
+
+    vector<pair<int, int>> edges;
+    Triangulate(points, edges);
+
+    PointGrid grid(points, max(1., options.maxLength));
+    for(const pair<int, int> &edge : edges)
+    {
+        const QVector2D &a = points[edge.first];
+        const QVector2D &b = points[edge.second];
+        double length = a.distanceToPoint(b);
+        if(length > options.maxLength)
+            continue;
+
+        bool isBlocked = false;
+        if(options.relativeNeighborhood)
+        {
+            // Another system blocks this link if it is closer to both ends
+            // than they are to each other. All such systems are within the
+            // link's length of the first end.
+            isBlocked = grid.Any(a, length, edge.first, edge.second, [&a, &b, length](const QVector2D &point)
+            {
+                return a.distanceToPoint(point) < length && b.distanceToPoint(point) < length;
+            });
+        }
+        else
+        {
+            // Another system blocks this link if it is inside the circle that
+            // has the link as its diameter.
+            QVector2D center = .5 * (a + b);
+            double radius = .5 * length;
+            isBlocked = grid.Any(center, radius, edge.first, edge.second, [&center, radius](const QVector2D &point)
+            {
+                return center.distanceToPoint(point) < radius;
+            });
+        }
+        if(isBlocked)
+            continue;
+
+        System *first = systems[edge.first];
+        System *second = systems[edge.second];
+        if(!first->Links().count(second->Name()) && !second->Links().count(first->Name()))
+            result.emplace_back(first, second);
+    }
+    return result;
+}
+
+
+
+// Find the edges of the Delaunay triangulation of the given points, as
+// pairs of indices with the lower index first. Points that are in the same
+// place as an earlier point are left out.
+void LinkGenerator::Triangulate(const vector<QVector2D> &points, vector<pair<int, int>> &edges)
+{
+    edges.clear();
+    const int count = static_cast<int>(points.size());
+    if(count < 2)
+        return;
+
+    // Start with one huge triangle that contains all the points. Its corners
+    // are stored after the real points.
+    double left = points[0].x(), right = left, top = points[0].y(), bottom = top;
+    for(const QVector2D &point : points)
+    {
+        left = min<double>(left, point.x());
+        right = max<double>(right, point.x());
+        top = min<double>(top, point.y());
+        bottom = max<double>(bottom, point.y());
+    }
+    double size = max(1., max(right - left, bottom - top));
+    double centerX = .5 * (left + right);
+    double centerY = .5 * (top + bottom);
+    vector<QVector2D> vertex = points;
+    vertex.emplace_back(centerX - 20. * size, centerY - 20. * size);
+    vertex.emplace_back(centerX + 20. * size, centerY - 20. * size);
+    vertex.emplace_back(centerX, centerY + 20. * size);
+
+    vector<Triangle> triangles;
+    triangles.push_back({{count, count + 1, count + 2}, {-1, -1, -1}, true});
+
+    // Insert the points in the order of their location, rather than in the
+    // order they were given, so that each one is near the last triangle
+    // that was created and finding the triangle it falls in is quick.
+    vector<int> order(count);
+    for(int i = 0; i < count; ++i)
+        order[i] = i;
+    const double band = max(1., size / sqrt(static_cast<double>(count)));
+    sort(order.begin(), order.end(), [&points, band](int a, int b)
+    {
+        int rowA = static_cast<int>(floor(points[a].y() / band));
+        int rowB = static_cast<int>(floor(points[b].y() / band));
+        if(rowA != rowB)
+            return rowA < rowB;
+        // Go back and forth, so the end of one row is next to the start of
+        // the next.
+        return (rowA & 1) ? points[a].x() > points[b].x() : points[a].x() < points[b].x();
+    });
+
+    vector<int> bad;
+    vector<char> isBad;
+    // Each boundary edge of the hole: its start, its end, and the triangle on
+    // the far side of it.
+    struct Edge { int from; int to; int outside; };
+    vector<Edge> boundary;
+    int last = 0;
+    for(int index : order)
+    {
+        const QVector2D &point = vertex[index];
+
+        // Walk from the last new triangle toward the point until reaching the
+        // triangle that contains it. If the walk goes on too long (which can
+        // only happen due to rounding error), check every triangle instead.
+        int current = last;
+        int steps = 0;
+        while(true)
+        {
+            const Triangle &triangle = triangles[current];
+            int next = -1;
+            for(int i = 0; i < 3 && next < 0; ++i)
+            {
+                const QVector2D &a = vertex[triangle.corner[(i + 1) % 3]];
+                const QVector2D &b = vertex[triangle.corner[(i + 2) % 3]];
+                if(Orient(a, b, point) < 0.)
+                    next = triangle.neighbor[i];
+            }
+            if(next < 0 || ++steps > static_cast<int>(triangles.size()))
+                break;
+            current = next;
+        }
+        if(steps > static_cast<int>(triangles.size()))
+        {
+            current = -1;
+            for(unsigned t = 0; t < triangles.size() && current < 0; ++t)
+            {
+                const Triangle &triangle = triangles[t];
+                if(!triangle.isAlive)
+                    continue;
+                bool isInside = true;
+                for(int i = 0; i < 3; ++i)
+                    isInside &= (Orient(vertex[triangle.corner[(i + 1) % 3]], vertex[triangle.corner[(i + 2) % 3]], point) >= 0.);
+                if(isInside)
+                    current = t;
+            }
+            if(current < 0)
+                continue;
+        }
+
+        // Skip any point that is in the same place as one already added.
+        bool isDuplicate = false;
+        for(int i = 0; i < 3; ++i)
+            isDuplicate |= (vertex[triangles[current].corner[i]] == point);
+        if(isDuplicate)
+            continue;
+
+        // Find every triangle whose circumcircle contains the point. They
+        // form a connected hole around the point.
+        isBad.resize(triangles.size(), 0);
+        bad.clear();
+        bad.push_back(current);
+        isBad[current] = 1;
+        for(unsigned i = 0; i < bad.size(); ++i)
+        {
+            const Triangle &triangle = triangles[bad[i]];
+            for(int neighbor : triangle.neighbor)
+            {
+                if(neighbor < 0 || isBad[neighbor])
+                    continue;
+                const Triangle &other = triangles[neighbor];
+                if(InCircle(vertex[other.corner[0]], vertex[other.corner[1]], vertex[other.corner[2]], point))
+                {
+                    isBad[neighbor] = 1;
+                    bad.push_back(neighbor);
+                }
+            }
+        }
+
+        // The edges of the hole are the edges of bad triangles that do not
+        // border another bad triangle.
+        boundary.clear();
+        for(int t : bad)
+        {
+            Triangle &triangle = triangles[t];
+            triangle.isAlive = false;
+            for(int i = 0; i < 3; ++i)
+                if(triangle.neighbor[i] < 0 || !isBad[triangle.neighbor[i]])
+                    boundary.push_back({triangle.corner[(i + 1) % 3], triangle.corner[(i + 2) % 3], triangle.neighbor[i]});
+        }
+        for(int t : bad)
+            isBad[t] = 0;
+
+        // Fill the hole with a fan of triangles around the new point. The
+        // new triangle on edge (from, to) shares its edge (to, point) with
+        // the new triangle that starts at "to".
+        int first = static_cast<int>(triangles.size());
+        for(const Edge &edge : boundary)
+        {
+            int t = static_cast<int>(triangles.size());
+            triangles.push_back({{edge.from, edge.to, index}, {-1, -1, edge.outside}, true});
+            if(edge.outside >= 0)
+            {
+                Triangle &outside = triangles[edge.outside];
+                for(int i = 0; i < 3; ++i)
+                    if(outside.corner[i] != edge.from && outside.corner[i] != edge.to)
+                        outside.neighbor[i] = t;
+            }
+        }
+        for(unsigned i = first; i < triangles.size(); ++i)
+            for(unsigned j = first; j < triangles.size(); ++j)
+            {
+                if(triangles[j].corner[0] == triangles[i].corner[1])
+                    triangles[i].neighbor[0] = j;
+                if(triangles[j].corner[1] == triangles[i].corner[0])
+                    triangles[i].neighbor[1] = j;
+            }
+        last = first;
+    }
+
+    // Collect the edges between real points. Each interior edge belongs to two
+    // triangles, so the duplicates must be removed.
+    for(const Triangle &triangle : triangles)
+    {
+        if(!triangle.isAlive)
+            continue;
+        for(int i = 0; i < 3; ++i)
+        {
+            int a = triangle.corner[(i + 1) % 3];
+            int b = triangle.corner[(i + 2) % 3];
+            if(a < count && b < count)
+                edges.emplace_back(min(a, b), max(a, b));
+        }
+    }
+    sort(edges.begin(), edges.end());
+    edges.erase(unique(edges.begin(), edges.end()), edges.end());
+}
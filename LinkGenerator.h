@@ -0,0 +1,56 @@
+/* LinkGenerator.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef LINKGENERATOR_H
+#define LINKGENERATOR_H
+
+#include <QVector2D>
+
+#include <utility>
+#include <vector>
+
+class System;
+
+
+
+// Class for proposing hyperspace links between a group of systems, based only
+// on where they are. First, the systems are connected by a Delaunay
+// triangulation, which links every system to its natural neighbors without
+// any links crossing. That has too many links to be a good map, so only the
+// links that pass a "proximity" test are kept: in a Gabriel graph, no other
+// system may be inside the circle whose diameter is the link; in a relative
+// neighborhood graph (which has fewer links), no other system may be closer to
+// both ends of the link than they are to each other.
+class LinkGenerator {
+public:
+    struct Options {
+        // Never propose a link longer than this.
+        double maxLength = 150.;
+        // Use the relative neighborhood graph instead of the Gabriel graph.
+        bool relativeNeighborhood = true;
+    };
+
+
+public:
+    // Propose links between the given systems, leaving out any that already
+    // exist. Each pair of systems is listed once.
+    static std::vector<std::pair<System *, System *>> Propose(const std::vector<System *> &systems, const Options &options);
+
+    // Find the edges of the Delaunay triangulation of the given points, as
+    // pairs of indices with the lower index first. Points that are in the same
+    // place as an earlier point are left out.
+    static void Triangulate(const std::vector<QVector2D> &points, std::vector<std::pair<int, int>> &edges);
+};
+
+
+
+#endif // LINKGENERATOR_H
@@ -0,0 +1,145 @@
+/* LinkGraph.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "LinkGraph.h"
+
+#include "Map.h"
+#include "System.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+
+LinkGraph::LinkGraph(Map &map)
+{
+    Build(map);
+}
+
+
+
+// Rebuild the graph from the given map's current systems and links.
+void LinkGraph::Build(Map &map)
+{
+    systems.clear();
+    names.clear();
+    offsets.clear();
+    links.clear();
+    reverseOffsets.clear();
+    reverseLinks.clear();
+
+    for(auto &it : map.Systems())
+    {
+        systems.push_back(&it.second);
+        names.push_back(it.first);
+    }
+
+    offsets.push_back(0);
+    for(const System *system : systems)
+    {
+        for(const QString &name : system->Links())
+        {
+            int index = Index(name);
+            if(index >= 0)
+                links.push_back(index);
+        }
+        offsets.push_back(static_cast<int>(links.size()));
+    }
+
+    // Sort the links by the system they go to, to find the links into each
+    // system. A link's source is in increasing order within each run.
+    reverseOffsets.assign(systems.size() + 1, 0);
+    for(int link : links)
+        ++reverseOffsets[link + 1];
+    for(unsigned i = 1; i < reverseOffsets.size(); ++i)
+        reverseOffsets[i] += reverseOffsets[i - 1];
+    reverseLinks.resize(links.size());
+    vector<int> next(reverseOffsets.begin(), reverseOffsets.end() - 1);
+    for(int i = 0; i < Size(); ++i)
+        for(int link : Links(i))
+            reverseLinks[next[link]++] = i;
+}
+
+
+
+int LinkGraph::Size() const
+{
+    return static_cast<int>(systems.size());
+}
+
+
+
+System *LinkGraph::GetSystem(int index) const
+{
+    return systems[index];
+}
+
+
+
+// Get the index of the given system, or -1 if it is not in the graph.
+int LinkGraph::Index(const QString &name) const
+{
+    auto it = lower_bound(names.begin(), names.end(), name);
+    return (it == names.end() || *it != name) ? -1 : static_cast<int>(it - names.begin());
+}
+
+
+
+int LinkGraph::Index(const System *system) const
+{
+    if(!system)
+        return -1;
+    int index = Index(system->Name());
+    return (index >= 0 && systems[index] == system) ? index : -1;
+}
+
+
+
+// Get the indices of the systems that the given system links to.
+LinkGraph::Range LinkGraph::Links(int index) const
+{
+    const int *data = links.data();
+    return Range(data + offsets[index], data + offsets[index + 1]);
+}
+
+
+
+// Get the indices of the systems that link to the given system.
+LinkGraph::Range LinkGraph::LinksTo(int index) const
+{
+    const int *data = reverseLinks.data();
+    return Range(data + reverseOffsets[index], data + reverseOffsets[index + 1]);
+}
+
+
+
+// Find every system that can be reached from the given one, in order of
+// how many jumps away they are. The result is cleared first.
+void LinkGraph::Reachable(int start, vector<int> &result) const
+{
+    result.clear();
+    if(start < 0 || start >= Size())
+        return;
+
+    // The result itself is the queue for the breadth-first search.
+    vector<bool> visited(systems.size(), false);
+    visited[start] = true;
+    result.push_back(start);
+    for(unsigned i = 0; i < result.size(); ++i)
+        for(int link : Links(result[i]))
+            if(!visited[link])
+            {
+                visited[link] = true;
+                result.push_back(link);
+            }
+}
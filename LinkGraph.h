@@ -0,0 +1,82 @@
+/* LinkGraph.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef LINKGRAPH_H
+#define LINKGRAPH_H
+
+#include <QString>
+
+#include <vector>
+
+class Map;
+class System;
+
+
+
+// Class representing the hyperspace links of a map as a compact graph. Each
+// system is given an index (in order of name, the same order the map stores
+// them in), and the links out of each system are stored as one contiguous run
+// of indices in a single array. Algorithms that visit every system many times
+// can then work with plain arrays instead of looking up names in the map.
+// Links to systems that do not exist are left out.
+class LinkGraph {
+public:
+    // The links out of one system.
+    class Range {
+    public:
+        Range(const int *first, const int *last) : first(first), last(last) {}
+        const int *begin() const { return first; }
+        const int *end() const { return last; }
+        int size() const { return static_cast<int>(last - first); }
+
+    private:
+        const int *first;
+        const int *last;
+    };
+
+
+public:
+    LinkGraph() = default;
+    explicit LinkGraph(Map &map);
+
+    // Rebuild the graph from the given map's current systems and links.
+    void Build(Map &map);
+
+    int Size() const;
+    System *GetSystem(int index) const;
+    // Get the index of the given system, or -1 if it is not in the graph.
+    int Index(const QString &name) const;
+    int Index(const System *system) const;
+    // Get the indices of the systems that the given system links to.
+    Range Links(int index) const;
+    // Get the indices of the systems that link to the given system.
+    Range LinksTo(int index) const;
+
+    // Find every system that can be reached from the given one, in order of
+    // how many jumps away they are. The result is cleared first.
+    void Reachable(int start, std::vector<int> &result) const;
+
+
+private:
+    std::vector<System *> systems;
+    std::vector<QString> names;
+    // The links out of system i are links[offsets[i]] to links[offsets[i + 1]].
+    std::vector<int> offsets;
+    std::vector<int> links;
+    // The same, for the links into each system.
+    std::vector<int> reverseOffsets;
+    std::vector<int> reverseLinks;
+};
+
+
+
+#endif // LINKGRAPH_H
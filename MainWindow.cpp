@@ -16,12 +16,15 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "GalaxyView.h"
 #include "Map.h"
 #include "PlanetView.h"
+#include "Random.h"
 #include "SystemView.h"
 
 #include <QAction>
 #include <QDragEnterEvent>
 #include <QFileDialog>
 #include <QHBoxLayout>
+#include <QInputDialog>
+#include <QLineEdit>
 #include <QMenu>
 #include <QMenuBar>
 #include <QMessageBox>
@@ -60,6 +63,7 @@ void MainWindow::DoOpen(const QString &path)
         return;
 
     map.Load(path);
+    galaxyView->Reload();
     galaxyView->Center();
     systemView->Select(nullptr);
     planetView->Reinitialize();
@@ -144,6 +148,27 @@ void MainWindow::SaveAs()
 
 
 
+// Show the seed that all random generation is based on, and allow it to be
+// changed. Entering the same seed again repeats the same random results.
+void MainWindow::SetSeed()
+{
+    bool ok = false;
+    QString text = QInputDialog::getText(this, "Random seed",
+        "Seed for all randomize operations from now on:",
+        QLineEdit::Normal, QString::number(Random::Seed()), &ok);
+    if(!ok)
+        return;
+
+    qulonglong seed = text.trimmed().toULongLong(&ok);
+    if(ok)
+        Random::SetSeed(seed);
+    else
+        QMessageBox::warning(this, "Invalid seed",
+            "The seed must be a whole number between 0 and 18446744073709551615.");
+}
+
+
+
 void MainWindow::Quit()
 {
     close();
@@ -266,6 +291,9 @@ void MainWindow::CreateMenus()
         saveAsAction->setShortcut(QKeySequence::SaveAs);
         fileMenu->addSeparator();
 
+        fileMenu->addAction("Random Seed...", this, SLOT(SetSeed()));
+        fileMenu->addSeparator();
+
         QAction *quitAction = fileMenu->addAction("Quit", this, SLOT(Quit()));
         quitAction->setShortcut(QKeySequence::Quit);
     }
@@ -288,6 +316,46 @@ void MainWindow::CreateMenus()
         QAction *randomizeCommodityAction = galaxyMenu->addAction("Randomize Commodity");
         connect(randomizeCommodityAction, SIGNAL(triggered()), galaxyView, SLOT(RandomizeCommodity()));
         randomizeCommodityAction->setShortcut(QKeySequence("C"));
+
+        QAction *randomizeAllAction = galaxyMenu->addAction("Randomize All Commodities");
+        connect(randomizeAllAction, SIGNAL(triggered()), galaxyView, SLOT(RandomizeAllCommodities()));
+        randomizeAllAction->setShortcut(QKeySequence("Shift+C"));
+
+        QAction *smoothPricesAction = galaxyMenu->addAction("Smooth Prices...");
+        connect(smoothPricesAction, SIGNAL(triggered()), galaxyView, SLOT(SmoothPrices()));
+
+        QAction *proposeLinksAction = galaxyMenu->addAction("Propose Links...");
+        connect(proposeLinksAction, SIGNAL(triggered()), galaxyView, SLOT(ProposeLinks()));
+
+        QAction *pinAction = galaxyMenu->addAction("Pin/Unpin System");
+        connect(pinAction, SIGNAL(triggered()), galaxyView, SLOT(TogglePin()));
+        pinAction->setShortcut(QKeySequence("F"));
+
+        QAction *relaxAction = galaxyMenu->addAction("Relax Layout");
+        connect(relaxAction, SIGNAL(triggered()), galaxyView, SLOT(RelaxLayout()));
+        relaxAction->setShortcut(QKeySequence("L"));
+
+        QAction *regenerateAction = galaxyMenu->addAction("Regenerate Systems...");
+        connect(regenerateAction, SIGNAL(triggered()), galaxyView, SLOT(RegenerateSystems()));
+        galaxyMenu->addSeparator();
+
+        QAction *checkLayoutAction = galaxyMenu->addAction("Check Layout");
+        connect(checkLayoutAction, SIGNAL(triggered()), galaxyView, SLOT(CheckLayout()));
+
+        QAction *chokepointsAction = galaxyMenu->addAction("Show/Hide Chokepoints");
+        connect(chokepointsAction, SIGNAL(triggered()), galaxyView, SLOT(ToggleChokepoints()));
+        chokepointsAction->setShortcut(QKeySequence("K"));
+
+        QAction *distancesAction = galaxyMenu->addAction("Show/Hide Jump Distances");
+        connect(distancesAction, SIGNAL(triggered()), galaxyView, SLOT(ToggleJumpDistances()));
+        distancesAction->setShortcut(QKeySequence("J"));
+
+        QAction *namesAction = galaxyMenu->addAction("Show/Hide System Names");
+        connect(namesAction, SIGNAL(triggered()), galaxyView, SLOT(ToggleNames()));
+        namesAction->setShortcut(QKeySequence("N"));
+
+        QAction *timeDrawingAction = galaxyMenu->addAction("Time Drawing");
+        connect(timeDrawingAction, SIGNAL(triggered()), galaxyView, SLOT(TimeDrawing()));
     }
 
     // System Menu:
@@ -342,6 +410,10 @@ void MainWindow::CreateMenus()
         QAction *pause = systemMenu->addAction("Pause/Unpause");
         connect(pause, SIGNAL(triggered()), systemView, SLOT(Pause()));
         pause->setShortcut(QKeySequence(Qt::Key_Space));
+
+        QAction *trails = systemMenu->addAction("Show/Hide Orbits");
+        connect(trails, SIGNAL(triggered()), systemView, SLOT(ToggleTrails()));
+        trails->setShortcut(QKeySequence("O"));
     }
 
     // Activate only the menu for the current tab.
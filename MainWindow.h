@@ -44,6 +44,7 @@ public slots:
     void Open();
     void Save();
     void SaveAs();
+    void SetSeed();
     void Quit();
 
     void TabChanged(int);
@@ -27,8 +27,11 @@ using namespace std;
 
 void Map::Load(const QString &path)
 {
-    // Clear everything first.
+    // Clear everything first, except for the revision number, which must
+    // never repeat.
+    int lastRevision = revision;
     *this = Map();
+    revision = lastRevision;
 
     QFileInfo p = QFileInfo(path);
 
@@ -65,6 +68,7 @@ void Map::Load(const QString &path)
                     commodities.emplace_back(child.Token(1), child.Value(2), child.Value(3));
 
     isChanged = false;
+    ++revision;
 }
 
 
@@ -120,6 +124,8 @@ const QString &Map::FileName() const
 void Map::SetChanged(bool changed)
 {
     isChanged = changed;
+    if(changed)
+        ++revision;
 }
 
 
@@ -131,6 +137,15 @@ bool Map::IsChanged() const
 
 
 
+// This number goes up every time the map is loaded or changed, so that
+// anything drawn from the map can tell when it is out of date.
+int Map::Revision() const
+{
+    return revision;
+}
+
+
+
 list<Galaxy> &Map::Galaxies()
 {
     return galaxies;
@@ -38,6 +38,9 @@ public:
     // Mark this file as changed.
     void SetChanged(bool changed = true);
     bool IsChanged() const;
+    // This number goes up every time the map is loaded or changed, so that
+    // anything drawn from the map can tell when it is out of date.
+    int Revision() const;
 
     std::list<Galaxy> &Galaxies();
     const std::list<Galaxy> &Galaxies() const;
@@ -77,6 +80,7 @@ private:
     std::list<DataNode> unparsed;
 
     mutable bool isChanged = false;
+    int revision = 0;
 };
 
 #endif // MAP_H
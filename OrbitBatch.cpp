@@ -0,0 +1,160 @@
+/* OrbitBatch.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "OrbitBatch.h"
+
+#include "pi.h"
+#include "StellarObject.h"
+#include "System.h"
+
+#include <map>
+
+using namespace std;
+
+namespace {
+    // Round to the nearest integer. Adding and then subtracting 1.5 * 2^52
+    // pushes the fractional bits out of the mantissa. Unlike floor() or
+    // round(), this is plain arithmetic that any vectorizer can handle.
+    inline double Round(double value)
+    {
+        static const double MAGIC = 6755399441055744.;
+        return (value + MAGIC) - MAGIC;
+    }
+}
+
+
+
+// Remove all the objects from this batch.
+void OrbitBatch::Clear()
+{
+    distance.clear();
+    speed.clear();
+    phase.clear();
+    parent.clear();
+    x.clear();
+    y.clear();
+}
+
+
+
+// Add all the stellar objects in the given system to this batch, and return
+// the batch index of the first of them.
+int OrbitBatch::Add(const System &system)
+{
+    int first = Size();
+    map<int, int> index;
+    for(const StellarObject *object : system.Objects())
+    {
+        index[object->Id()] = Size();
+        Add(object->Distance(), object->Period(), object->Offset(),
+            object->Parent() >= 0 ? index[object->Parent()] : -1);
+    }
+    return first;
+}
+
+
+
+// Add a single orbit. The parent is a batch index, or -1 if the object
+// orbits the system center.
+void OrbitBatch::Add(double distance, double period, double offset, int parent)
+{
+    this->distance.push_back(distance);
+    speed.push_back(period ? 1. / period : 0.);
+    phase.push_back(offset / 360.);
+    this->parent.push_back(parent);
+    x.push_back(0.f);
+    y.push_back(0.f);
+}
+
+
+
+// Calculate the position of every object on the given day.
+void OrbitBatch::SetDay(double day)
+{
+    const int count = Size();
+    angle.resize(count);
+    sine.resize(count);
+    cosine.resize(count);
+
+    // First, find every object's position relative to its parent. None of these
+    // loops depend on the results of any other iteration.
+    for(int i = 0; i < count; ++i)
+        angle[i] = day * speed[i] + phase[i];
+    SinCos(angle.data(), sine.data(), cosine.data(), count);
+    for(int i = 0; i < count; ++i)
+    {
+        x[i] = distance[i] * sine[i];
+        y[i] = -distance[i] * cosine[i];
+    }
+
+    // Then, add in the parent positions. Because parents always come before
+    // their children, each parent's position is final by the time it is used.
+    for(int i = 0; i < count; ++i)
+        if(parent[i] >= 0)
+        {
+            x[i] += x[parent[i]];
+            y[i] += y[parent[i]];
+        }
+}
+
+
+
+int OrbitBatch::Size() const
+{
+    return static_cast<int>(distance.size());
+}
+
+
+
+// Get the position an object had on the most recently set day.
+QVector2D OrbitBatch::Position(int index) const
+{
+    return QVector2D(x[index], y[index]);
+}
+
+
+
+// Calculate the sine and cosine of each of the given angles, which are
+// measured in full turns rather than in degrees or radians. This avoids calling
+// the library sin() and cos() (which cannot be vectorized), and is accurate to
+// well beyond the precision of the single-precision positions it is used for.
+void OrbitBatch::SinCos(const double *turns, double *sine, double *cosine, int count)
+{
+    for(int i = 0; i < count; ++i)
+    {
+        // Find the nearest quarter turn, and the remainder from it, which will
+        // be in the range [-1/8, 1/8] turns, i.e. [-pi/4, pi/4] radians.
+        double quarters = Round(turns[i] * 4.);
+        double r = (turns[i] - quarters * .25) * (2. * PI);
+        double r2 = r * r;
+
+        // Taylor series for sine and cosine. Over this small a range, the first
+        // omitted terms are smaller than 1e-11.
+        double s = r * (1. + r2 * (-1. / 6. + r2 * (1. / 120. + r2 * (-1. / 5040.
+            + r2 * (1. / 362880. + r2 * (-1. / 39916800.))))));
+        double c = 1. + r2 * (-.5 + r2 * (1. / 24. + r2 * (-1. / 720.
+            + r2 * (1. / 40320. + r2 * (-1. / 3628800. + r2 * (1. / 479001600.))))));
+
+        // Rotate the result by the given number of quarter turns, using
+        // sin(a + 90) = cos(a) and cos(a + 90) = -sin(a). This is done with
+        // arithmetic instead of branches so that the loop can be vectorized.
+        // All the values being rounded here are multiples of 1/4, so
+        // subtracting a bit less than 1/2 before rounding gives the floor.
+        double quadrant = quarters - 4. * Round(quarters * .25 - .375);
+        double half = Round(quadrant * .5 - .25);
+        double isOdd = quadrant - 2. * half;
+        double cosineHalf = Round((quadrant + 1.) * .5 - .25);
+        double cosineSign = 1. - 2. * (cosineHalf - 2. * Round(cosineHalf * .5 - .25));
+        sine[i] = (s + isOdd * (c - s)) * (1. - 2. * half);
+        cosine[i] = (c + isOdd * (s - c)) * cosineSign;
+    }
+}
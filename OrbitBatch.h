@@ -0,0 +1,73 @@
+/* OrbitBatch.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef ORBITBATCH_H
+#define ORBITBATCH_H
+
+#include <QVector2D>
+
+#include <vector>
+
+class System;
+
+
+
+// Class for calculating the positions of many orbiting objects at once. The
+// orbital elements are stored as separate arrays rather than as an array of
+// objects, so the angle and sine / cosine of every orbit can be calculated in
+// one tight loop that the compiler is able to vectorize. Each object's parent
+// is then added in in a second pass. Objects from any number of systems can be
+// added to the same batch, as long as each object comes after its parent.
+class OrbitBatch {
+public:
+    // Remove all the objects from this batch.
+    void Clear();
+    // Add all the stellar objects in the given system to this batch, and return
+    // the batch index of the first of them.
+    int Add(const System &system);
+    // Add a single orbit. The parent is a batch index, or -1 if the object
+    // orbits the system center.
+    void Add(double distance, double period, double offset, int parent = -1);
+
+    // Calculate the position of every object on the given day.
+    void SetDay(double day);
+
+    int Size() const;
+    // Get the position an object had on the most recently set day.
+    QVector2D Position(int index) const;
+
+    // Calculate the sine and cosine of each of the given angles, which are
+    // measured in full turns rather than in degrees or radians.
+    static void SinCos(const double *turns, double *sine, double *cosine, int count);
+
+
+private:
+    // Orbital elements. Angles are stored in turns, so the angle on any given
+    // day is just day * speed + phase.
+    std::vector<double> distance;
+    std::vector<double> speed;
+    std::vector<double> phase;
+    std::vector<int> parent;
+
+    // Scratch space for the vectorized calculations.
+    std::vector<double> angle;
+    std::vector<double> sine;
+    std::vector<double> cosine;
+
+    // Positions on the most recently set day.
+    std::vector<float> x;
+    std::vector<float> y;
+};
+
+
+
+#endif // ORBITBATCH_H
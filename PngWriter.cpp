@@ -0,0 +1,164 @@
+/* PngWriter.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "PngWriter.h"
+
+using namespace std;
+
+namespace {
+    // Compressed data is written out in chunks of this many bytes.
+    static const size_t CHUNK_SIZE = 1 << 16;
+
+    QByteArray BigEndian(uint32_t value)
+    {
+        QByteArray result(4, '\0');
+        for(int i = 0; i < 4; ++i)
+            result[i] = static_cast<char>(value >> (24 - 8 * i));
+        return result;
+    }
+}
+
+
+
+// Open the given file, and write the header for an image of the given size.
+PngWriter::PngWriter(const QString &path, int width, int height)
+    : file(path), width(width), height(height)
+{
+    if(width <= 0 || height <= 0 || !file.open(QIODevice::WriteOnly))
+        return;
+
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    if(deflateInit(&stream, Z_DEFAULT_COMPRESSION) != Z_OK)
+        return;
+    isCompressing = true;
+    isGood = true;
+    row.resize(1 + 3 * static_cast<size_t>(width));
+    buffer.resize(CHUNK_SIZE);
+    stream.next_out = buffer.data();
+    stream.avail_out = static_cast<uInt>(buffer.size());
+
+    file.write("\x89PNG\r\n\x1A\n", 8);
+    // 8 bits per channel, RGB, not interlaced.
+    QByteArray header = BigEndian(width) + BigEndian(height);
+    header.append(static_cast<char>(8));
+    header.append(static_cast<char>(2));
+    header.append(3, static_cast<char>(0));
+    WriteChunk("IHDR", header);
+}
+
+
+
+PngWriter::~PngWriter()
+{
+    if(isCompressing)
+        deflateEnd(&stream);
+}
+
+
+
+// Check whether the file was opened and everything so far was written.
+bool PngWriter::IsGood() const
+{
+    return isGood;
+}
+
+
+
+// Add the next row of the image, which must be the given width. The alpha
+// channel of each pixel is ignored.
+void PngWriter::AddRow(const QRgb *pixels)
+{
+    if(!isGood || rows >= height)
+        return;
+
+    // Store each byte as the difference from the same channel of the pixel to
+    // its left. That way, any area of a single color is all zeros.
+    row[0] = 1;
+    uint8_t previous[3] = {0, 0, 0};
+    for(int x = 0; x < width; ++x)
+    {
+        uint8_t channels[3] = {
+            static_cast<uint8_t>(qRed(pixels[x])),
+            static_cast<uint8_t>(qGreen(pixels[x])),
+            static_cast<uint8_t>(qBlue(pixels[x]))};
+        for(int i = 0; i < 3; ++i)
+        {
+            row[1 + 3 * x + i] = channels[i] - previous[i];
+            previous[i] = channels[i];
+        }
+    }
+    Compress(row.data(), row.size(), Z_NO_FLUSH);
+    ++rows;
+}
+
+
+
+// Finish the file. This fails if not every row of the image was added.
+bool PngWriter::Finish()
+{
+    if(!isGood || rows != height)
+        return false;
+
+    Compress(nullptr, 0, Z_FINISH);
+    Flush();
+    deflateEnd(&stream);
+    isCompressing = false;
+    WriteChunk("IEND", QByteArray());
+    file.close();
+    return isGood;
+}
+
+
+
+// Compress the given bytes, which are part of the image data. Once all the
+// data has been added, call this with Z_FINISH to end the stream.
+void PngWriter::Compress(const uint8_t *data, size_t size, int flush)
+{
+    stream.next_in = const_cast<uint8_t *>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    while(isGood)
+    {
+        int result = deflate(&stream, flush);
+        if(result == Z_STREAM_ERROR)
+            isGood = false;
+        // If the buffer is full, there may be more output waiting.
+        else if(!stream.avail_out)
+            Flush();
+        else if(result == Z_STREAM_END || (flush == Z_NO_FLUSH && !stream.avail_in))
+            break;
+    }
+}
+
+
+
+// Write out the compressed data that has been buffered.
+void PngWriter::Flush()
+{
+    size_t size = buffer.size() - stream.avail_out;
+    if(size)
+        WriteChunk("IDAT", QByteArray(reinterpret_cast<const char *>(buffer.data()), static_cast<int>(size)));
+    stream.next_out = buffer.data();
+    stream.avail_out = static_cast<uInt>(buffer.size());
+}
+
+
+
+void PngWriter::WriteChunk(const char *type, const QByteArray &data)
+{
+    QByteArray body = QByteArray(type, 4) + data;
+    uLong crc = crc32(0L, reinterpret_cast<const Bytef *>(body.constData()), static_cast<uInt>(body.size()));
+    QByteArray chunk = BigEndian(data.size()) + body + BigEndian(crc);
+    if(file.write(chunk) != chunk.size())
+        isGood = false;
+}
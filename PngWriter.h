@@ -0,0 +1,72 @@
+/* PngWriter.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QRgb>
+#include <QString>
+
+#include <zlib.h>
+
+#include <cstdint>
+#include <vector>
+
+
+
+// Class for writing a PNG image one row at a time, so that images much too big
+// to hold in memory can still be saved. The image data is compressed with zlib
+// as it is added, so only a little of it is ever held in memory.
+class PngWriter {
+public:
+    // Open the given file, and write the header for an image of the given size.
+    PngWriter(const QString &path, int width, int height);
+    ~PngWriter();
+
+    // Check whether the file was opened and everything so far was written.
+    bool IsGood() const;
+    // Add the next row of the image, which must be the given width. The alpha
+    // channel of each pixel is ignored.
+    void AddRow(const QRgb *pixels);
+    // Finish the file. This fails if not every row of the image was added.
+    bool Finish();
+
+
+private:
+    // Compress the given bytes, which are part of the image data. Once all the
+    // data has been added, call this with Z_FINISH to end the stream.
+    void Compress(const uint8_t *data, size_t size, int flush);
+    // Write out the compressed data that has been buffered.
+    void Flush();
+    void WriteChunk(const char *type, const QByteArray &data);
+
+
+private:
+    QFile file;
+    bool isGood = false;
+    int width;
+    int height;
+    int rows = 0;
+
+    std::vector<uint8_t> row;
+
+    // Compressed data that has not been written out yet.
+    std::vector<uint8_t> buffer;
+    z_stream stream;
+    bool isCompressing = false;
+};
+
+
+
+#endif // PNGWRITER_H
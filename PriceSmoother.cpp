@@ -0,0 +1,74 @@
+/* PriceSmoother.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "PriceSmoother.h"
+
+#include "LinkGraph.h"
+
+using namespace std;
+
+
+
+// Smooth the given values. If not empty, "weights" says how much each
+// system counts in its neighbors' averages (0 means it is ignored), and
+// "pinned" marks systems whose values must not change.
+void PriceSmoother::Smooth(const LinkGraph &graph, vector<double> &values, const Settings &settings,
+    const vector<double> &weights, const vector<char> &pinned)
+{
+    const int count = graph.Size();
+    if(static_cast<int>(values.size()) != count)
+        return;
+
+    // Turn the optional inputs into dense arrays, so the inner loops do not
+    // need to check whether they were given.
+    vector<double> weight = weights;
+    weight.resize(count, 1.);
+    vector<double> change(count, 1.);
+    for(int i = 0; i < count && i < static_cast<int>(pinned.size()); ++i)
+        change[i] = pinned[i] ? 0. : 1.;
+
+    const double self = settings.selfWeight;
+    const double low = settings.low;
+    const double high = settings.high;
+    vector<double> average(count);
+    vector<double> next(count);
+    for(int pass = 0; pass < settings.iterations; ++pass)
+    {
+        // Gather the weighted average of each system's neighbors. A system
+        // with no neighbors that count is its own average.
+        for(int i = 0; i < count; ++i)
+        {
+            double sum = 0.;
+            double total = 0.;
+            for(int link : graph.Links(i))
+            {
+                sum += weight[link] * values[link];
+                total += weight[link];
+            }
+            average[i] = total ? sum / total : values[i];
+        }
+
+        // Blend, clamp, and then undo the change for any pinned systems.
+        const double *value = values.data();
+        const double *mean = average.data();
+        const double *scale = change.data();
+        double *out = next.data();
+        for(int i = 0; i < count; ++i)
+        {
+            double blended = self * value[i] + (1. - self) * mean[i];
+            blended = (blended < low) ? low : blended;
+            blended = (blended > high) ? high : blended;
+            out[i] = value[i] + scale[i] * (blended - value[i]);
+        }
+        values.swap(next);
+    }
+}
@@ -0,0 +1,53 @@
+/* PriceSmoother.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef PRICESMOOTHER_H
+#define PRICESMOOTHER_H
+
+#include <limits>
+#include <vector>
+
+class LinkGraph;
+
+
+
+// Class for smoothing out a value (usually a commodity price) that is defined
+// for every system, by repeatedly moving each system's value toward the
+// average of the systems it links to. The values are stored in one dense array
+// indexed the same way as the link graph. Each pass first gathers the neighbor
+// averages, then blends, pins, and clamps every value in one loop with no
+// branches, which the compiler can vectorize.
+class PriceSmoother {
+public:
+    struct Settings {
+        // How many smoothing passes to make.
+        int iterations = 1;
+        // How much of each system's own value is kept in each pass. At .5, the
+        // value moves halfway to the average of its neighbors.
+        double selfWeight = .5;
+        // The smoothed values are kept within this range.
+        double low = -std::numeric_limits<double>::infinity();
+        double high = std::numeric_limits<double>::infinity();
+    };
+
+
+public:
+    // Smooth the given values. If not empty, "weights" says how much each
+    // system counts in its neighbors' averages (0 means it is ignored), and
+    // "pinned" marks systems whose values must not change.
+    static void Smooth(const LinkGraph &graph, std::vector<double> &values, const Settings &settings,
+        const std::vector<double> &weights = std::vector<double>(), const std::vector<char> &pinned = std::vector<char>());
+};
+
+
+
+#endif // PRICESMOOTHER_H
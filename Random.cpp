@@ -0,0 +1,134 @@
+/* Random.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "Random.h"
+
+#include <mutex>
+#include <random>
+
+using namespace std;
+
+namespace {
+    // SplitMix64, which turns any 64-bit value (even zero, or a run of
+    // similar values) into a well mixed one. This is used for seeding.
+    uint64_t SplitMix(uint64_t &x)
+    {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t Rotate(uint64_t x, int k)
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    // The program-wide seed, and how many operation streams have been handed
+    // out since it was set.
+    mutex operationMutex;
+    uint64_t operationSeed = Random::NewSeed();
+    uint64_t operationCount = 0;
+}
+
+
+
+Random::Random(uint64_t seed, uint64_t stream)
+{
+    // Mix the seed and the stream number separately, so that nearby seeds and
+    // nearby stream numbers do not produce overlapping states.
+    uint64_t x = SplitMix(seed) ^ Rotate(SplitMix(stream), 32);
+    for(uint64_t &word : state)
+        word = SplitMix(x);
+}
+
+
+
+// Set the seed that every operation's stream is derived from. This also
+// restarts the sequence of streams. Until a seed is set, one is picked at
+// random when the program starts.
+void Random::SetSeed(uint64_t seed)
+{
+    lock_guard<mutex> lock(operationMutex);
+    operationSeed = seed;
+    operationCount = 0;
+}
+
+
+
+uint64_t Random::Seed()
+{
+    lock_guard<mutex> lock(operationMutex);
+    return operationSeed;
+}
+
+
+
+// Get a stream of random numbers for one operation. Each call returns a
+// different stream, in a sequence determined only by the seed. This is
+// safe to call from any thread.
+Random Random::Operation()
+{
+    lock_guard<mutex> lock(operationMutex);
+    return Random(operationSeed, operationCount++);
+}
+
+
+
+// Get a new stream, independent of this one, for handing to a sub-task or
+// to another thread. This advances this stream, so each split differs.
+Random Random::Split()
+{
+    uint64_t seed = Next();
+    return Random(seed, Next());
+}
+
+
+
+// Get a random 64-bit value.
+uint64_t Random::Next()
+{
+    uint64_t result = Rotate(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = Rotate(state[3], 45);
+
+    return result;
+}
+
+
+
+// Get a random integer in the range [0, bound). This is the replacement for
+// rand() % bound, and returns 0 if the bound is not positive.
+int Random::Int(int bound)
+{
+    if(bound <= 0)
+        return 0;
+
+    // Scale the high 32 bits into the range instead of using the remainder,
+    // which is faster and less biased.
+    return static_cast<int>(((Next() >> 32) * static_cast<uint64_t>(bound)) >> 32);
+}
+
+
+
+// Pick a seed for an operation that was not given one.
+uint64_t Random::NewSeed()
+{
+    random_device device;
+    return (static_cast<uint64_t>(device()) << 32) ^ device();
+}
@@ -0,0 +1,63 @@
+/* Random.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+
+
+// Class representing a stream of random numbers (using the xoshiro256**
+// generator). Unlike rand(), each stream has its own state, so the results of
+// procedural generation depend only on the seed it was given, and separate
+// streams can be used on separate threads. Two streams with the same seed but
+// different stream numbers produce unrelated sequences.
+//
+// Every editing operation asks for its own stream with Operation(). Those
+// streams are all derived from one program-wide seed, which the user can set
+// in order to repeat a sequence of operations exactly.
+class Random {
+public:
+    explicit Random(uint64_t seed = 0, uint64_t stream = 0);
+
+    // Set the seed that every operation's stream is derived from. This also
+    // restarts the sequence of streams. Until a seed is set, one is picked at
+    // random when the program starts.
+    static void SetSeed(uint64_t seed);
+    static uint64_t Seed();
+    // Get a stream of random numbers for one operation. Each call returns a
+    // different stream, in a sequence determined only by the seed. This is
+    // safe to call from any thread.
+    static Random Operation();
+
+    // Get a new stream, independent of this one, for handing to a sub-task or
+    // to another thread. This advances this stream, so each split differs.
+    Random Split();
+
+    // Get a random 64-bit value.
+    uint64_t Next();
+    // Get a random integer in the range [0, bound). This is the replacement for
+    // rand() % bound, and returns 0 if the bound is not positive.
+    int Int(int bound);
+
+    // Pick a seed for an operation that was not given one.
+    static uint64_t NewSeed();
+
+
+private:
+    uint64_t state[4];
+};
+
+
+
+#endif // RANDOM_H
@@ -0,0 +1,204 @@
+/* SpatialIndex.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "SpatialIndex.h"
+
+#include "Map.h"
+#include "System.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+    // The width of each grid cell. This matches the range of a jump drive, so
+    // finding a system's neighbors only requires checking a few cells.
+    static const double CELL_SIZE = 100.;
+}
+
+
+
+// Index the given map's systems. The index keeps a pointer to the map so
+// that it can rebuild itself if the systems change.
+void SpatialIndex::Build(Map &map)
+{
+    this->map = &map;
+    Invalidate();
+    Update();
+}
+
+
+
+// Forget everything, e.g. because systems were added, removed, or renamed.
+// The index is rebuilt the next time it is used.
+void SpatialIndex::Invalidate()
+{
+    isValid = false;
+}
+
+
+
+// Call this after changing a system's position, with its old position.
+void SpatialIndex::Move(System *system, const QVector2D &from)
+{
+    if(!isValid || !system)
+        return;
+
+    int64_t oldKey = Key(from);
+    int64_t newKey = Key(system->Position());
+    if(oldKey == newKey)
+        return;
+
+    auto it = cells.find(oldKey);
+    if(it == cells.end())
+    {
+        Invalidate();
+        return;
+    }
+    vector<System *> &cell = it->second;
+    auto sit = find(cell.begin(), cell.end(), system);
+    if(sit == cell.end())
+    {
+        Invalidate();
+        return;
+    }
+    *sit = cell.back();
+    cell.pop_back();
+    if(cell.empty())
+        cells.erase(it);
+    cells[newKey].push_back(system);
+}
+
+
+
+// Make sure the grid includes all of the map's current systems. Each query
+// does this if needed, so this only has to be called before querying the
+// index from several threads at once.
+void SpatialIndex::Update()
+{
+    if(!map)
+        return;
+    if(isValid && count == map->Systems().size())
+        return;
+
+    cells.clear();
+    for(auto &it : map->Systems())
+        cells[Key(it.second.Position())].push_back(&it.second);
+    count = map->Systems().size();
+    isValid = true;
+}
+
+
+
+// Find the system closest to the given point, if any is within the given
+// distance of it.
+System *SpatialIndex::Nearest(const QVector2D &point, double maxDistance)
+{
+    System *nearest = nullptr;
+    double best = maxDistance * maxDistance;
+    QRectF rect(point.x() - maxDistance, point.y() - maxDistance, 2. * maxDistance, 2. * maxDistance);
+    ForEach(rect, [&nearest, &best, &point](System *system)
+    {
+        double d = (system->Position() - point).lengthSquared();
+        if(d < best)
+        {
+            best = d;
+            nearest = system;
+        }
+    });
+    return nearest;
+}
+
+
+
+// Find all the systems within the given distance of a point, or inside the
+// given rectangle. The results are added to the given vector.
+void SpatialIndex::Radius(const QVector2D &point, double radius, vector<System *> &result)
+{
+    double limit = radius * radius;
+    QRectF rect(point.x() - radius, point.y() - radius, 2. * radius, 2. * radius);
+    ForEach(rect, [&result, &point, limit](System *system)
+    {
+        if((system->Position() - point).lengthSquared() <= limit)
+            result.push_back(system);
+    });
+}
+
+
+
+void SpatialIndex::Rect(const QRectF &rect, vector<System *> &result)
+{
+    QRectF bounds = rect.normalized();
+    ForEach(bounds, [&result, &bounds](System *system)
+    {
+        QVector2D pos = system->Position();
+        if(pos.x() >= bounds.left() && pos.x() <= bounds.right()
+                && pos.y() >= bounds.top() && pos.y() <= bounds.bottom())
+            result.push_back(system);
+    });
+}
+
+
+
+// Call the given function for every system in the cells that overlap the
+// given rectangle.
+template <class F>
+void SpatialIndex::ForEach(const QRectF &rect, F function)
+{
+    Update();
+    int left = Cell(rect.left());
+    int right = Cell(rect.right());
+    int top = Cell(rect.top());
+    int bottom = Cell(rect.bottom());
+
+    // If the rectangle covers more cells than actually have systems in them,
+    // it is faster to just check every cell.
+    double area = (right - left + 1.) * (bottom - top + 1.);
+    if(area > cells.size())
+    {
+        for(const auto &it : cells)
+            for(System *system : it.second)
+                function(system);
+        return;
+    }
+
+    for(int y = top; y <= bottom; ++y)
+        for(int x = left; x <= right; ++x)
+        {
+            auto it = cells.find(Key(x, y));
+            if(it != cells.end())
+                for(System *system : it->second)
+                    function(system);
+        }
+}
+
+
+
+int SpatialIndex::Cell(double coordinate)
+{
+    return static_cast<int>(floor(coordinate / CELL_SIZE));
+}
+
+
+
+int64_t SpatialIndex::Key(int x, int y)
+{
+    return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(y));
+}
+
+
+
+int64_t SpatialIndex::Key(const QVector2D &point)
+{
+    return Key(Cell(point.x()), Cell(point.y()));
+}
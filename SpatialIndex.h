@@ -0,0 +1,78 @@
+/* SpatialIndex.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QRectF>
+#include <QVector2D>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class Map;
+class System;
+
+
+
+// Class for quickly finding the systems near a given point or inside a given
+// rectangle. The map is divided into a uniform grid of square cells, the same
+// size as the range of a jump drive, and each cell lists the systems inside
+// it. Only the cells that contain at least one system are stored. When a
+// system is dragged to a new position, it just moves from one cell to another.
+class SpatialIndex {
+public:
+    // Index the given map's systems. The index keeps a pointer to the map so
+    // that it can rebuild itself if the systems change.
+    void Build(Map &map);
+    // Forget everything, e.g. because systems were added, removed, or renamed.
+    // The index is rebuilt the next time it is used.
+    void Invalidate();
+    // Call this after changing a system's position, with its old position.
+    void Move(System *system, const QVector2D &from);
+    // Make sure the grid includes all of the map's current systems. Each query
+    // does this if needed, so this only has to be called before querying the
+    // index from several threads at once.
+    void Update();
+
+    // Find the system closest to the given point, if any is within the given
+    // distance of it.
+    System *Nearest(const QVector2D &point, double maxDistance);
+    // Find all the systems within the given distance of a point, or inside the
+    // given rectangle. The results are added to the given vector.
+    void Radius(const QVector2D &point, double radius, std::vector<System *> &result);
+    void Rect(const QRectF &rect, std::vector<System *> &result);
+
+
+private:
+    // Call the given function for every system in the cells that overlap the
+    // given rectangle.
+    template <class F>
+    void ForEach(const QRectF &rect, F function);
+
+    static int Cell(double coordinate);
+    static int64_t Key(int x, int y);
+    static int64_t Key(const QVector2D &point);
+
+
+private:
+    Map *map = nullptr;
+    bool isValid = false;
+    size_t count = 0;
+
+    std::unordered_map<int64_t, std::vector<System *>> cells;
+};
+
+
+
+#endif // SPATIALINDEX_H
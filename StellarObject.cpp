@@ -13,6 +13,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "StellarObject.h"
 
 #include "Planet.h"
+#include "Random.h"
 
 #include <QString>
 
@@ -233,6 +234,14 @@ double StellarObject::Period() const
 
 
 
+// Get the angle (in degrees) that this object's orbit was at on day zero.
+double StellarObject::Offset() const
+{
+    return offset;
+}
+
+
+
 // Get the radius of this planet, i.e. how close you must be to land.
 double StellarObject::Radius() const
 {
@@ -252,7 +261,16 @@ const QString &StellarObject::GetPlanet() const
 
 
 
-// Get the index of the parent object.
+// Get the ID of this object, which stays the same for as long as the object
+// is part of its system.
+int StellarObject::Id() const
+{
+    return id;
+}
+
+
+
+// Get the ID of the parent object, or -1 if this orbits the system center.
 int StellarObject::Parent() const
 {
     return parent;
@@ -260,10 +278,18 @@ int StellarObject::Parent() const
 
 
 
+// Get the IDs of the objects orbiting this one, innermost first.
+const vector<int> &StellarObject::Children() const
+{
+    return children;
+}
+
+
+
 // Get a random star, based on a probability distribution of stars.
-StellarObject StellarObject::Star()
+StellarObject StellarObject::Star(Random &random)
 {
-    int r = rand() % 100;
+    int r = random.Int(100);
     auto it = INFO.lower_bound("star");
     while(it != INFO.end() && r >= it->second.info)
     {
@@ -284,51 +310,53 @@ StellarObject StellarObject::Star()
 
 
 // Get a random "moon." It may also be used as a stand-alone planet.
-StellarObject StellarObject::Moon()
+StellarObject StellarObject::Moon(Random &random)
 {
-    return Planet(0, MOON_RADIUS);
+    return Planet(random, 0, MOON_RADIUS);
 }
 
 
 
 // Get a random (non-giant) planet. It may or may not be habitable.
-StellarObject StellarObject::Planet()
+StellarObject StellarObject::Planet(Random &random)
 {
-    return Planet(MOON_RADIUS, GIANT_RADIUS);
+    return Planet(random, MOON_RADIUS, GIANT_RADIUS);
 }
 
 
 
 // Get a random planet that can exist outside the habitable zone.
-StellarObject StellarObject::Uninhabited()
+StellarObject StellarObject::Uninhabited(Random &random)
 {
-    return Planet(MOON_RADIUS, GIANT_RADIUS, true);
+    return Planet(random, MOON_RADIUS, GIANT_RADIUS, true);
 }
 
 
 
 // Get a random gas giant.
-StellarObject StellarObject::Giant()
+StellarObject StellarObject::Giant(Random &random)
 {
-    return Planet(GIANT_RADIUS);
+    return Planet(random, GIANT_RADIUS);
 }
 
 
 
 // Get a random station.
-StellarObject StellarObject::Station()
+StellarObject StellarObject::Station(Random &random)
 {
-    static int count = 0;
-    if(!count)
+    // Count the stations only once. Initializing a static this way is thread
+    // safe, so this can be called from parallel generation.
+    static const int count = []() -> int
     {
-        // Skip stars and anything bigger than a radius of 50 pixels.
+        int total = 0;
         for(const auto &it : INFO)
             if(it.second.info == 3 && it.first[0] == 'p')
-                ++count;
-    }
+                ++total;
+        return total;
+    }();
 
     StellarObject object;
-    int r = rand() % count;
+    int r = random.Int(count);
     for(const auto &it : INFO)
         if(it.second.info == 3 && it.first[0] == 'p')
         {
@@ -401,7 +429,7 @@ void StellarObject::SetPlanet(const QString &name)
 
 
 
-StellarObject StellarObject::Planet(int minRadius, int maxRadius, bool skipHabitable)
+StellarObject StellarObject::Planet(Random &random, int minRadius, int maxRadius, bool skipHabitable)
 {
     int count = 0;
     for(const auto &it : INFO)
@@ -410,7 +438,7 @@ StellarObject StellarObject::Planet(int minRadius, int maxRadius, bool skipHabit
                 ++count;
 
     StellarObject object;
-    int r = rand() % count;
+    int r = random.Int(count);
     for(const auto &it : INFO)
         if(it.second.radius >= minRadius && it.second.radius < maxRadius)
             if(it.first[0] == 'p' && !(skipHabitable && it.second.info) && it.second.info != 3)
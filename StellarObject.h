@@ -18,6 +18,10 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <QVector2D>
 #include <QString>
 
+#include <vector>
+
+class Random;
+
 
 
 // Class representing a planet, star, moon, or other large object in space. This
@@ -28,7 +32,6 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 class StellarObject {
 public:
     StellarObject() = default;
-    StellarObject(int parent) : parent(parent) {};
 
     // Some objects do not have sprites, because they are just an orbital
     // center for two or more other objects.
@@ -40,6 +43,8 @@ public:
     double Distance() const;
     // Get the number of days it takes for this object to complete one orbit.
     double Period() const;
+    // Get the angle (in degrees) that this object's orbit was at on day zero.
+    double Offset() const;
     // Get the radius of this planet, i.e. how close you must be to land.
     double Radius() const;
     // If it is possible to land on this planet, this returns the Planet
@@ -47,21 +52,26 @@ public:
     // function will just return nullptr.
     const QString &GetPlanet() const;
 
-    // Get the index of the parent object.
+    // Get the ID of this object, which stays the same for as long as the object
+    // is part of its system.
+    int Id() const;
+    // Get the ID of the parent object, or -1 if this orbits the system center.
     int Parent() const;
+    // Get the IDs of the objects orbiting this one, innermost first.
+    const std::vector<int> &Children() const;
 
     // Get a random star, based on a probability distribution of stars.
-    static StellarObject Star();
+    static StellarObject Star(Random &random);
     // Get a random "moon." It may also be used as a stand-alone planet.
-    static StellarObject Moon();
+    static StellarObject Moon(Random &random);
     // Get a random (non-giant) planet. It may or may not be habitable.
-    static StellarObject Planet();
+    static StellarObject Planet(Random &random);
     // Get a random planet that can exist outside the habitable zone.
-    static StellarObject Uninhabited();
+    static StellarObject Uninhabited(Random &random);
     // Get a random gas giant.
-    static StellarObject Giant();
+    static StellarObject Giant(Random &random);
     // Get a random station.
-    static StellarObject Station();
+    static StellarObject Station(Random &random);
 
     // Check if this is a star.
     bool IsStar() const;
@@ -80,7 +90,7 @@ public:
 
 
 private:
-    static StellarObject Planet(int minRadius, int maxRadius = 1000, bool skipHabitable = false);
+    static StellarObject Planet(Random &random, int minRadius, int maxRadius = 1000, bool skipHabitable = false);
 
 
 private:
@@ -92,7 +102,9 @@ private:
     double distance = 0.;
     double period = 0.;
     double offset = 0.;
+    int id = -1;
     int parent = -1;
+    std::vector<int> children;
 
     std::list<DataNode> unparsed;
 
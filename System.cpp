@@ -14,12 +14,15 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 #include "DataNode.h"
 #include "DataWriter.h"
-#include "pi.h"
+#include "Ephemeris.h"
 #include "Planet.h"
+#include "Random.h"
 
 #include <QString>
+#include <QtConcurrent>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <limits>
 #include <set>
@@ -37,6 +40,12 @@ namespace {
 
     static const int RANDOM_STAR_DISTANCE = 40;
     static const double MIN_STAR_DISTANCE = 40.;
+
+    static const int RANDOMIZE_ATTEMPTS = 100;
+
+    // Source of orbit revision numbers. Systems are randomized in parallel, so
+    // this may be used from more than one thread.
+    static atomic<int> lastOrbitRevision(0);
 }
 
 
@@ -113,8 +122,8 @@ void System::Save(DataWriter &file) const
                 file.Write("fleet", it.name, it.period);
         for(const DataNode &node : unparsed)
             file.Write(node);
-        for(const StellarObject &object : objects)
-            SaveObject(file, object);
+        for(const StellarObject *object : Objects())
+            SaveObject(file, *object);
     }
     file.EndChild();
 }
@@ -152,18 +161,40 @@ const set<QString> &System::Links() const
 
 
 
-// Get the stellar object locations on the most recently set date.
-vector<StellarObject> &System::Objects()
+// Get the stellar objects, ordered so that each object comes after the
+// object it orbits. The pointers stay valid until that object is deleted.
+// The order is rebuilt by the first call after the system is copied or an
+// object is added or removed, even if the system is const, so that call
+// must not happen while other threads are reading the same system.
+const vector<StellarObject *> &System::Objects()
+{
+    UpdateOrder();
+    return order.objects;
+}
+
+
+
+const vector<const StellarObject *> &System::Objects() const
+{
+    UpdateOrder();
+    return order.constObjects;
+}
+
+
+
+// Find the object with the given ID, or return nullptr if there is none.
+StellarObject *System::Object(int id)
 {
-    return objects;
+    auto it = objects.find(id);
+    return (it == objects.end()) ? nullptr : &it->second;
 }
 
 
 
-// Get the stellar object locations on the most recently set date.
-const vector<StellarObject> &System::Objects() const
+const StellarObject *System::Object(int id) const
 {
-    return objects;
+    auto it = objects.find(id);
+    return (it == objects.end()) ? nullptr : &it->second;
 }
 
 
@@ -182,14 +213,15 @@ double System::HabitableZone() const
 double System::OccupiedRadius(const StellarObject &object) const
 {
     // Make sure the object is part of this system and is a primary object.
-    if(&object < &objects.front() || &object > &objects.back() || object.Parent() >= 0 || object.IsStar())
+    if(!Owns(&object) || object.Parent() >= 0 || object.IsStar())
         return 0.;
 
     double radius = object.Radius();
-    int index = &object - &objects.front();
-    for(const StellarObject &other : objects)
-        if(other.Parent() == index)
-            radius = max(radius, other.Distance() + other.Radius());
+    for(int id : object.children)
+    {
+        const StellarObject &child = *Object(id);
+        radius = max(radius, child.Distance() + child.Radius());
+    }
 
     return radius;
 }
@@ -201,9 +233,10 @@ double System::OccupiedRadius() const
     if(objects.empty())
         return 0.;
 
-    double radius = objects.back().Radius() + objects.back().Distance();
-    if(objects.back().Parent() >= 0)
-        radius += objects[objects.back().Parent()].Distance();
+    const StellarObject &last = *Objects().back();
+    double radius = last.Radius() + last.Distance();
+    if(last.Parent() >= 0)
+        radius += Object(last.Parent())->Distance();
 
     return radius;
 }
@@ -213,8 +246,9 @@ double System::OccupiedRadius() const
 double System::StarRadius() const
 {
     double radius = 0.;
-    for(const StellarObject &other : objects)
+    for(int id : roots)
     {
+        const StellarObject &other = *Object(id);
         if(!other.IsStar())
             break;
         radius = max(radius, other.Distance() + other.Radius());
@@ -224,6 +258,16 @@ double System::StarRadius() const
 
 
 
+// Get a number that changes whenever any object is added, removed, or put
+// in a different orbit. Two systems only share a revision if one is a copy
+// of the other, so their orbits are the same.
+int System::OrbitRevision() const
+{
+    return orbitRevision;
+}
+
+
+
 // Get the specification of how many asteroids of each type there are.
 const vector<System::Asteroid> &System::Asteroids() const
 {
@@ -274,28 +318,44 @@ const vector<System::Fleet> &System::Fleets() const
 void System::SetDay(double day)
 {
     timeStep = day;
-    for(StellarObject &object : objects)
+    if(orbitsChanged)
     {
-        double angle = (!object.period ? 0. : day * 360. / object.period) + object.offset;
-        angle *= TO_RAD;
+        orbits.Clear();
+        orbits.Add(*this);
+        orbitsChanged = false;
+    }
+
+    // Because of the order of the objects, an object's parent always comes
+    // before it, which is the order the batch needs to add in parent positions.
+    orbits.SetDay(day);
+    const vector<StellarObject *> &ordered = Objects();
+    for(unsigned i = 0; i < ordered.size(); ++i)
+        ordered[i]->position = orbits.Position(i);
+}
+
 
-        object.position = object.distance * QVector2D(sin(angle), -cos(angle));
 
-        // Because of the order of the vector, the parent's position has always
-        // been updated before this loop reaches any of its children, so:
-        if(object.parent >= 0)
-            object.position += objects[object.parent].position;
+// Position the planets by looking them up in a precomputed table.
+void System::SetDay(double day, const Ephemeris &ephemeris)
+{
+    // If the table is out of date, fall back to calculating the orbits.
+    if(!ephemeris.Matches(*this))
+    {
+        SetDay(day);
+        return;
     }
+
+    timeStep = day;
+    const vector<StellarObject *> &ordered = Objects();
+    for(unsigned i = 0; i < ordered.size(); ++i)
+        ordered[i]->position = ephemeris.Position(i, day);
 }
 
 
 
 void System::LoadObject(const DataNode &node, int parent)
 {
-    int index = static_cast<int>(objects.size());
-
-    objects.emplace_back(parent);
-    StellarObject &object = objects.back();
+    StellarObject &object = AddObject(StellarObject(), parent);
 
     if(node.Size() >= 2)
         object.planet = node.Token(1);
@@ -311,7 +371,7 @@ void System::LoadObject(const DataNode &node, int parent)
         else if(child.Token(0) == "offset" && child.Size() >= 2)
             object.offset = child.Value(1);
         else if(child.Token(0) == "object")
-            LoadObject(child, index);
+            LoadObject(child, object.id);
         else
             object.unparsed.push_back(child);
     }
@@ -327,7 +387,7 @@ void System::SaveObject(DataWriter &file, const StellarObject &object) const
     {
         file.BeginChild();
         ++level;
-        parent = objects[parent].parent;
+        parent = Object(parent)->parent;
     }
     if(!object.planet.isEmpty())
         file.Write("object", object.planet);
@@ -353,14 +413,14 @@ void System::SaveObject(DataWriter &file, const StellarObject &object) const
 
 
 
-void System::Init(const QString &name, const QVector2D &position)
+void System::Init(const QString &name, const QVector2D &position, Random &random)
 {
     this->name = name;
     this->position = position;
 
-    Randomize(true, false);
-    ChangeAsteroids();
-    ChangeMinables();
+    Randomize(true, false, random);
+    ChangeAsteroids(random);
+    ChangeMinables(random);
 }
 
 
@@ -423,38 +483,38 @@ void System::SetTrade(const QString &commodity, int value)
 
 void System::Move(StellarObject *object, double dDistance, double dAngle)
 {
-    if(!object || !object->period || object->IsStar())
+    if(!Owns(object) || !object->period || object->IsStar())
         return;
 
     // Find the next object in from this object. Determine what the orbital
     // radius of that object is. Don't allow objects too close together.
-    auto it = objects.begin() + (object - &objects.front());
-    auto root = (it->Parent() >= 0 ? objects.begin() + it->Parent() : it);
-    if(root != objects.begin())
+    StellarObject *root = Root(object);
+    auto rootIt = find(roots.begin(), roots.end(), root->id);
+    if(rootIt != roots.begin())
     {
-        auto previous = root - 1;
-        while(previous != objects.begin() && previous->Parent() >= 0)
-            --previous;
-
-        double previousOccupied = previous->IsStar() ?
-            StarRadius() : (OccupiedRadius(*previous) + previous->Distance());
+        const StellarObject &previous = *Object(rootIt[-1]);
+        double previousOccupied = previous.IsStar() ?
+            StarRadius() : (OccupiedRadius(previous) + previous.Distance());
         double rootOccupied = root->Distance() - OccupiedRadius(*root);
 
         double gap = rootOccupied - previousOccupied;
-        double sign = (it == root ? 1. : -1.);
+        double sign = (object == root ? 1. : -1.);
         gap += sign * dDistance;
         if(gap < MIN_GAP)
             dDistance += sign * (MIN_GAP - gap);
     }
     // If this is a moon, we also have to make sure it does not collide with
     // whatever planet is in one space from it.
+    const vector<int> &siblings = Siblings(*object);
+    auto it = find(siblings.begin(), siblings.end(), object->id);
     if(object->Parent() >= 0)
     {
-        double previousOccupied = it[-1].Radius();
-        if(it[-1].Parent() >= 0)
-            previousOccupied += it[-1].Distance();
+        const StellarObject &previous = *Object(it == siblings.begin() ? object->Parent() : it[-1]);
+        double previousOccupied = previous.Radius();
+        if(previous.Parent() >= 0)
+            previousOccupied += previous.Distance();
 
-        double thisOccupied = it->Distance() - it->Radius();
+        double thisOccupied = object->Distance() - object->Radius();
         double gap = thisOccupied + dDistance - previousOccupied;
         if(gap < MIN_MOON_GAP)
             dDistance += MIN_MOON_GAP - gap;
@@ -466,28 +526,31 @@ void System::Move(StellarObject *object, double dDistance, double dAngle)
     // or out by whatever amount its radius changed by. If a child object was
     // moved, all the children after it must be moved by that amount and then
     // all root objects after it must be moved by twice that amount.
-    for( ; it != objects.end(); ++it)
-        if(it->Parent() < 0 || it->Parent() == object->Parent())
-        {
-            it->distance += dDistance;
-            Recompute(*it);
-        }
+    vector<int> moved(it, siblings.end());
+    if(object != root)
+        moved.insert(moved.end(), rootIt + 1, roots.end());
+    for(int id : moved)
+    {
+        StellarObject &other = *Object(id);
+        other.distance += dDistance;
+        Recompute(other);
+    }
 }
 
 
 
-void System::ChangeAsteroids()
+void System::ChangeAsteroids(Random &random)
 {
     asteroids.clear();
 
     // Pick the total number of asteroids. Bias towards small numbers, with
     // a few systems with many more.
-    int fullTotal = (rand() % 21) * (rand() % 21) + 1;
-    double energy = (rand() % 21 + 10) * (rand() % 21 + 10) * .01;
+    int fullTotal = random.Int(21) * random.Int(21) + 1;
+    double energy = (random.Int(21) + 10) * (random.Int(21) + 10) * .01;
     const QString suffix[2] = {" rock", " metal"};
     const QString prefix[3] = {"small", "medium", "large"};
 
-    int total[2] = {rand() % fullTotal, 0};
+    int total[2] = {random.Int(fullTotal), 0};
     total[1] = fullTotal - total[0];
 
     for(int i = 0; i < 2; ++i)
@@ -495,11 +558,11 @@ void System::ChangeAsteroids()
         if(!total[i])
             continue;
 
-        int count[3] = {0, rand() % total[i], 0};
+        int count[3] = {0, random.Int(total[i]), 0};
         int remaining = total[i] - count[1];
         if(remaining)
         {
-            count[0] = rand() % remaining;
+            count[0] = random.Int(remaining);
             count[2] = remaining - count[0];
         }
 
@@ -508,16 +571,16 @@ void System::ChangeAsteroids()
                 asteroids.emplace_back(
                     prefix[j] + suffix[i],
                     count[j],
-                    energy * (rand() % 101 + 50) * .01);
+                    energy * (random.Int(101) + 50) * .01);
     }
 }
 
 
 
-void System::ChangeMinables()
+void System::ChangeMinables(Random &random)
 {
     // First, change the belt radius.
-    belt = rand() % 1000 + 1000;
+    belt = random.Int(1000) + 1000;
     minables.clear();
     
     // Next, figure out the quantity and energy of the ordinary asteroids.
@@ -555,11 +618,11 @@ void System::ChangeMinables()
     for(int i = 0; i < 3; ++i)
     {
         // Pick three random minable types, with decreasing quantities.
-        totalCount = rand() % (totalCount + 1);
+        totalCount = random.Int(totalCount + 1);
         if(!totalCount)
             break;
         
-        int choice = rand() % 100;
+        int choice = random.Int(100);
         for(const auto &it : probability)
         {
             choice -= it.second;
@@ -572,43 +635,34 @@ void System::ChangeMinables()
     }
     for(const auto &it : choices)
     {
-        double energy = (rand() % 1000 + 1000) * .001 * meanEnergy;
+        double energy = (random.Int(1000) + 1000) * .001 * meanEnergy;
         minables.emplace_back(it.first, it.second, energy);
     }
 }
 
 
 
-void System::ChangeStar()
+void System::ChangeStar(Random &random)
 {
     double oldStarRadius = StarRadius();
-    unsigned oldStars = 0;
-    while(!objects.empty() && objects.front().IsStar())
-    {
-        objects.erase(objects.begin());
-        ++oldStars;
-    }
-
-    // If the number of stars is changing, all parent indices change.
-    unsigned stars = 1 + !(rand() % 3);
-    if(stars != oldStars)
-        for(StellarObject &object : objects)
-            if(object.parent >= 0)
-                object.parent += stars - oldStars;
+    while(!roots.empty() && Object(roots.front())->IsStar())
+        Erase(roots.front());
 
+    // The stars always come first, in front of any planets.
+    unsigned stars = 1 + !random.Int(3);
     double mass = 0.;
     if(stars == 1)
     {
-        StellarObject star = StellarObject::Star();
+        StellarObject star = StellarObject::Star(random);
         star.period = 10.;
         mass = pow(star.Radius(), 3.) * STAR_MASS_SCALE;
 
-        objects.insert(objects.begin(), star);
+        AddObject(star, -1, 0);
     }
     else
     {
-        StellarObject first = StellarObject::Star();
-        StellarObject second = StellarObject::Star();
+        StellarObject first = StellarObject::Star(random);
+        StellarObject second = StellarObject::Star(random);
         first.offset = 0.;
         second.offset = 180.;
 
@@ -618,7 +672,7 @@ void System::ChangeStar()
         double secondMass = pow(secondR, 3.) * STAR_MASS_SCALE;
         mass = firstMass + secondMass;
 
-        double distance = firstR + secondR + (rand() % RANDOM_STAR_DISTANCE) + MIN_STAR_DISTANCE;
+        double distance = firstR + secondR + random.Int(RANDOM_STAR_DISTANCE) + MIN_STAR_DISTANCE;
         // m1 * d1 = m2 * d2
         // d1 + d2 = d;
         // m1 * d1 = m2 * (d - d1)
@@ -633,41 +687,41 @@ void System::ChangeStar()
         first.period = period;
         second.period = period;
 
-        objects.insert(objects.begin(), (firstD < secondD) ? second : first);
-        objects.insert(objects.begin(), (firstD < secondD) ? first : second);
+        AddObject((firstD < secondD) ? first : second, -1, 0);
+        AddObject((firstD < secondD) ? second : first, -1, 1);
     }
     habitable = mass / HABITABLE_SCALE;
 
-    if(objects.size() > stars)
+    if(roots.size() > stars)
     {
         double newStarRadius = StarRadius();
-        Move(&objects[stars], newStarRadius - oldStarRadius);
+        Move(Object(roots[stars]), newStarRadius - oldStarRadius);
     }
 }
 
 
 
-void System::ChangeSprite(StellarObject *object)
+void System::ChangeSprite(StellarObject *object, Random &random)
 {
-    if(!object || object < &objects.front() || object > &objects.back())
+    if(!Owns(object))
         return;
 
     StellarObject newObject;
     set<QString> used = Used();
     do {
         if(object->IsStation())
-            newObject = StellarObject::Station();
+            newObject = StellarObject::Station(random);
         else if(object->IsMoon())
-            newObject = StellarObject::Moon();
+            newObject = StellarObject::Moon(random);
         else if(object->IsGiant())
-            newObject = StellarObject::Giant();
+            newObject = StellarObject::Giant(random);
         else
         {
-            double distance = (object->Parent() >= 0 ? objects[object->Parent()].Distance() : object->Distance());
+            double distance = Root(object)->Distance();
             if(distance >= .5 * habitable && distance < 2. * habitable)
-                newObject = StellarObject::Planet();
+                newObject = StellarObject::Planet(random);
             else
-                newObject = StellarObject::Uninhabited();
+                newObject = StellarObject::Uninhabited(random);
         }
     } while(used.count(newObject.Sprite()));
 
@@ -685,81 +739,80 @@ void System::ChangeSprite(StellarObject *object)
     // child distance += dRadius
     // after distance += 2 * dRadius
 
-    // Get the index of this object, for checking if other objects are children.
-    //int index = object - &objects.front();
-
-    // Get an iterator to this object.
-    auto it = objects.begin() + (object - &*objects.begin());
     // Move this object out by an amount equal to the radius change.
-    it->distance += radiusChange;
-    Recompute(*it);
+    object->distance += radiusChange;
+    Recompute(*object);
 
     // If this object has a parent, the parent's occupied radius will be
     // expanding by twice the radius change, so it must move out by that amount.
     // In addition, root objects beyond this one's parent will be moving out by
     // four times the radius change, instead of two.
-    if(object->Parent() >= 0)
+    vector<int> children = object->children;
+    StellarObject *root = Root(object);
+    if(object != root)
     {
         radiusChange *= 2.;
-        objects[object->Parent()].distance += radiusChange;
-        Recompute(objects[object->Parent()]);
+        root->distance += radiusChange;
+        Recompute(*root);
+
+        // The moons beyond this one move out along with it.
+        const vector<int> &siblings = Siblings(*object);
+        children.assign(find(siblings.begin(), siblings.end(), object->id) + 1, siblings.end());
     }
     // The objects that will be affected are: children of this object, and all
     // "root" objects outside of this one.
-    bool isChild = true;
-    for(++it; it != objects.end(); ++it)
+    for(int id : children)
     {
-        if(isChild && it->Parent() < 0)
-        {
-            isChild = false;
-            radiusChange *= 2.;
-        }
-        if(isChild || it->Parent() < 0)
-        {
-            it->distance += radiusChange;
-            Recompute(*it);
-        }
+        StellarObject &child = *Object(id);
+        child.distance += radiusChange;
+        Recompute(child);
+    }
+    radiusChange *= 2.;
+    for(auto it = find(roots.begin(), roots.end(), root->id) + 1; it != roots.end(); ++it)
+    {
+        StellarObject &other = *Object(*it);
+        other.distance += radiusChange;
+        Recompute(other);
     }
 }
 
 
 
-void System::AddPlanet()
+void System::AddPlanet(Random &random)
 {
     // The spacing between planets grows exponentially.
     int randomPlanetSpace = RANDOM_GAP;
-    for(const StellarObject &object : objects)
-        if(!object.IsStar() && object.Parent() < 0)
+    for(int id : roots)
+        if(!Object(id)->IsStar())
             randomPlanetSpace += randomPlanetSpace / 2;
 
     double distance = OccupiedRadius();
-    int space = rand() % randomPlanetSpace;
+    int space = random.Int(randomPlanetSpace);
     distance += (space * space) * .01 + MIN_GAP;
 
     set<QString> used = Used();
 
     StellarObject root;
-    int rootIndex = (int)objects.size();
 
     bool isHabitable = (distance > habitable * .5 && distance < habitable * 2. - 120.);
-    bool isSmall = !(rand() % 10);
-    bool isTerrestrial = !isSmall && (rand() % 2000 > distance);
+    bool isSmall = !random.Int(10);
+    bool isTerrestrial = !isSmall && (random.Int(2000) > distance);
 
     // Occasionally, moon-sized objects can be root objects. Otherwise, pick a
     // giant or a normal planet, with giants more frequent in the outer parts
     // of the solar system.
     do {
         if(isSmall)
-            root = StellarObject::Moon();
+            root = StellarObject::Moon(random);
         else if(isTerrestrial)
-            root = isHabitable ? StellarObject::Planet() : StellarObject::Uninhabited();
+            root = isHabitable ? StellarObject::Planet(random) : StellarObject::Uninhabited(random);
         else
-            root = StellarObject::Giant();
+            root = StellarObject::Giant(random);
     } while(used.count(root.Sprite()));
-    objects.push_back(root);
+    StellarObject &planet = AddObject(root);
     used.insert(root.Sprite());
 
-    int moonCount = rand() % (isTerrestrial ? (rand() % 2 + 1) : (rand() % 3 + 3));
+    int moonCount = random.Int(isTerrestrial ? (random.Int(2) + 1) : (random.Int(3) + 3));
     if(root.Radius() < 70)
         moonCount = 0;
 
@@ -767,144 +820,242 @@ void System::AddPlanet()
     int randomMoonSpace = RANDOM_MOON_GAP;
     for(int i = 0; i < moonCount; ++i)
     {
-        moonDistance += rand() % randomMoonSpace + MIN_MOON_GAP;
+        moonDistance += random.Int(randomMoonSpace) + MIN_MOON_GAP;
         // Each moon, on average, should be spaced more widely than the one before.
         randomMoonSpace += 20;
 
         // Use a moon sprite only once per system.
         StellarObject moon;
         do {
-            moon = StellarObject::Moon();
+            moon = StellarObject::Moon(random);
         } while(used.count(moon.Sprite()));
         used.insert(moon.Sprite());
 
         moon.distance = moonDistance + moon.Radius();
-        moon.parent = rootIndex;
+        moon.parent = planet.id;
         Recompute(moon, false);
-        objects.push_back(moon);
+        AddObject(moon, planet.id);
         moonDistance += 2. * moon.Radius();
     }
-    objects[rootIndex].distance = distance + moonDistance;
-    Recompute(objects[rootIndex], false);
+    planet.distance = distance + moonDistance;
+    Recompute(planet, false);
 }
 
 
 
-void System::AddMoon(StellarObject *object, bool isStation)
+void System::AddMoon(StellarObject *object, Random &random, bool isStation)
 {
-    if(!object || object < &objects.front() || object > &objects.back())
+    if(!Owns(object))
         return;
 
     double originalMoonDistance = object->Radius();
     int randomMoonSpace = RANDOM_MOON_GAP;
-    int rootIndex = object - &objects.front();
-    auto it = objects.begin() + rootIndex + 1;
-    while(it != objects.end() && it->Parent() == rootIndex)
+    for(int id : object->children)
     {
+        const StellarObject &child = *Object(id);
         randomMoonSpace += 20;
-        originalMoonDistance = it->Distance() + it->Radius();
-        ++it;
+        originalMoonDistance = child.Distance() + child.Radius();
     }
 
-    double moonDistance = originalMoonDistance + rand() % randomMoonSpace + MIN_MOON_GAP;
+    double moonDistance = originalMoonDistance + random.Int(randomMoonSpace) + MIN_MOON_GAP;
     set<QString> used = Used();
     StellarObject moon;
     do {
-        moon = isStation ? StellarObject::Station() : StellarObject::Moon();
+        moon = isStation ? StellarObject::Station(random) : StellarObject::Moon(random);
     } while(used.count(moon.Sprite()));
 
     moon.distance = moonDistance + moon.Radius();
-    moon.parent = rootIndex;
+    moon.parent = object->id;
     Recompute(moon, false);
 
     // Move the next root planet out from this one farther out.
     double distanceIncrease = moonDistance + 2. * moon.Radius() - originalMoonDistance;
-    if(it != objects.end())
-        Move(&*it, 2. * distanceIncrease);
+    StellarObject *next = Next(*object);
+    if(next)
+        Move(next, 2. * distanceIncrease);
 
     // Move this root planet farther out.
-    objects[rootIndex].distance += distanceIncrease;
-    Recompute(objects[rootIndex]);
+    object->distance += distanceIncrease;
+    Recompute(*object);
 
-    // Insert the new moon, then update the parent indices of all moons farther
-    // out than this one (because their parents' indices have changed).
-    it = objects.insert(it, moon);
-    for( ; it != objects.end(); ++it)
-        if(it->parent > rootIndex)
-            ++it->parent;
+    // The new moon is the outermost one, so it goes at the end of the list.
+    AddObject(moon, object->id);
 }
 
 
 
-void System::Randomize(bool allowHabitable, bool requireHabitable)
+// Generate new stars and planets. Many attempts are made in parallel to
+// find a layout that satisfies the given constraints; the result depends
+// only on the state of the given random number stream.
+void System::Randomize(bool allowHabitable, bool requireHabitable, Random &random)
 {
-    // Try to create a system satisfying the given parameters.
-    for(int i = 0; i < 100; ++i)
+    // Each attempt has its own random number stream, so the result of each
+    // one does not depend on which thread ran it or in what order. The lowest
+    // numbered attempt that succeeds is used, which is the same one that
+    // trying them one at a time would have picked.
+    const uint64_t seed = random.Next();
+    vector<System> attempts(RANDOMIZE_ATTEMPTS);
+    vector<int> indices;
+    for(int i = 0; i < RANDOMIZE_ATTEMPTS; ++i)
+        indices.push_back(i);
+
+    atomic<int> best(RANDOMIZE_ATTEMPTS);
+    QtConcurrent::blockingMap(indices, [&](int index)
     {
-        objects.clear();
-        ChangeStar();
-        while(OccupiedRadius() < 2000.)
-            AddPlanet();
-
-        bool isInhabited = false;
-        bool isHabitable = false;
-        for(const StellarObject &object : objects)
+        // Once an attempt has succeeded, there is no point in continuing any
+        // attempts numbered higher than it.
+        System &attempt = attempts[index];
+        attempt.timeStep = timeStep;
+        Random stream(seed, index);
+        if(index > best)
+            return;
+        attempt.ChangeStar(stream);
+        while(attempt.OccupiedRadius() < 2000.)
         {
-            isInhabited |= object.IsInhabited();
-            double d = object.Distance();
-            isHabitable |= object.Parent() < 0 && object.IsTerrestrial()
-                && d > .5 * habitable && d < 2. * habitable;
+            if(index > best)
+                return;
+            attempt.AddPlanet(stream);
         }
-        if(isInhabited && !allowHabitable)
-            continue;
-        if(!isHabitable && requireHabitable)
+        if(!attempt.IsAcceptable(allowHabitable, requireHabitable))
+            return;
+
+        int current = best;
+        while(index < current && !best.compare_exchange_weak(current, index))
             continue;
-        break;
-    }
+    });
+
+    // If no attempt succeeded, use the last one, as the serial search did.
+    System &result = attempts[min<int>(best, RANDOMIZE_ATTEMPTS - 1)];
+    objects.swap(result.objects);
+    roots.swap(result.roots);
+    nextId = result.nextId;
+    habitable = result.habitable;
+    order.isValid = false;
+    OrbitsChanged();
 }
 
 
 
 void System::Delete(StellarObject *object)
 {
-    if(!object || objects.empty())
-        return;
-
-    int index = object - &objects.front();
-    if(index < 0 || static_cast<unsigned>(index) >= objects.size())
+    if(!Owns(object))
         return;
 
     double shrink = object->Radius();
+    for(int id : object->children)
+    {
+        const StellarObject &child = *Object(id);
+        shrink = max(shrink, child.Distance() + child.Radius());
+    }
 
-    auto it = objects.begin() + index;
-    auto end = it + 1;
-    while(end != objects.end() && end->Parent() == index)
+    // Everything beyond this object moves in to fill the space it leaves.
+    StellarObject *next = Next(*object);
+    Erase(object->id);
+    if(next)
+        Move(next, -2. * shrink);
+}
+
+
+
+// Check that the stellar objects obey the spacing rules that Move()
+// enforces, and that each one's period matches its distance. A description of
+// each problem found is added to the given list, in order of the objects they
+// apply to.
+void System::CheckLayout(vector<QString> &problems) const
+{
+    // Problems are reported by each object's place in the file, which is also
+    // the order they are sorted in at the end.
+    const vector<const StellarObject *> &ordered = Objects();
+    map<int, int> index;
+    for(unsigned i = 0; i < ordered.size(); ++i)
+        index[ordered[i]->id] = i;
+
+    vector<pair<int, QString>> found;
+    auto describe = [this, &index](int id) -> QString
     {
-        shrink = max(shrink, end->Distance() + end->Radius());
-        ++end;
+        QString sprite = Object(id)->Sprite();
+        return "object " + QString::number(index[id]) + (sprite.isEmpty() ? "" : " (" + sprite + ")");
+    };
+    auto closer = [this](int a, int b) -> bool
+    {
+        return Object(a)->distance < Object(b)->distance;
+    };
+
+    // Each root object's occupied zone must be at least MIN_GAP away from the
+    // zone of the next object in, or from the stars.
+    vector<int> planets;
+    for(int id : roots)
+        if(!Object(id)->IsStar())
+            planets.push_back(id);
+    stable_sort(planets.begin(), planets.end(), closer);
+
+    int previous = -1;
+    double previousOccupied = StarRadius();
+    for(int id : planets)
+    {
+        const StellarObject &object = *Object(id);
+        double radius = OccupiedRadius(object);
+        double gap = object.distance - radius - previousOccupied;
+        if(gap < MIN_GAP)
+            found.emplace_back(index[id], describe(id) + " is " + QString::number(gap, 'f', 1)
+                + " from " + (previous < 0 ? QString("the star") : describe(previous))
+                + " (the minimum is " + QString::number(MIN_GAP) + ").");
+        previousOccupied = max(previousOccupied, object.distance + radius);
+        previous = id;
     }
-    int parentShift = end - it;
-    objects.erase(it, end);
 
-    it = objects.begin() + index;
-    if(it == objects.end())
-        return;
+    // Each moon must be at least MIN_MOON_GAP away from its planet and from the
+    // next moon in. Objects with no sprite are just the center of mass of a
+    // binary pair, whose members may share an orbit.
+    for(const StellarObject *parent : ordered)
+    {
+        if(parent->Sprite().isEmpty())
+            continue;
+        vector<int> children = parent->children;
+        stable_sort(children.begin(), children.end(), closer);
+        previous = parent->id;
+        previousOccupied = parent->Radius();
+        for(int id : children)
+        {
+            const StellarObject &moon = *Object(id);
+            double gap = moon.distance - moon.Radius() - previousOccupied;
+            if(gap < MIN_MOON_GAP)
+                found.emplace_back(index[id], describe(id) + " is " + QString::number(gap, 'f', 1)
+                    + " from " + describe(previous)
+                    + " (the minimum is " + QString::number(MIN_MOON_GAP) + ").");
+            previousOccupied = max(previousOccupied, moon.distance + moon.Radius());
+            previous = id;
+        }
+    }
 
-    Move(&*it, -2. * shrink);
-    for( ; it != objects.end(); ++it)
-        if(it->parent >= 0)
-            it->parent -= parentShift;
+    // Every period that Recompute() would set must match the distance. (The
+    // periods of the stars themselves are calculated differently.)
+    for(const StellarObject *object : ordered)
+    {
+        if(object->IsStar() || !object->distance || (object->parent < 0 && std::isnan(habitable)))
+            continue;
+
+        double expected = ExpectedPeriod(*object);
+        if(fabs(object->period - expected) > .01 * expected)
+            found.emplace_back(index[object->id], describe(object->id) + " has a period of "
+                + QString::number(object->period, 'f', 1) + " days, but its distance implies "
+                + QString::number(expected, 'f', 1) + ".");
+    }
+
+    stable_sort(found.begin(), found.end(),
+        [](const pair<int, QString> &a, const pair<int, QString> &b) -> bool
+        {
+            return a.first < b.first;
+        });
+    for(const auto &it : found)
+        problems.push_back(it.second);
 }
 
 
 
 void System::Recompute(StellarObject &object, bool updateOffset)
 {
-    double mass = habitable * HABITABLE_SCALE;
-    if(object.Parent() >= 0.)
-        mass = pow(objects[object.Parent()].Radius(), 3.) * PLANET_MASS_SCALE;
-
-    double newPeriod = sqrt(pow(object.distance, 3) / mass);
+    double newPeriod = ExpectedPeriod(object);
     if(updateOffset)
     {
         double delta = timeStep / object.period - timeStep / newPeriod;
@@ -912,6 +1063,135 @@ void System::Recompute(StellarObject &object, bool updateOffset)
         object.offset = fmod(object.offset, 360.);
     }
     object.period = newPeriod;
+    OrbitsChanged();
+}
+
+
+
+// Get the period that an object at its current distance should have.
+double System::ExpectedPeriod(const StellarObject &object) const
+{
+    double mass = habitable * HABITABLE_SCALE;
+    if(object.Parent() >= 0)
+        mass = pow(Object(object.Parent())->Radius(), 3.) * PLANET_MASS_SCALE;
+
+    return sqrt(pow(object.distance, 3) / mass);
+}
+
+
+
+// Create a new object, copied from the given one, orbiting the given parent
+// (or the system center, if the parent is -1). By default it is added beyond
+// all the parent's other children; otherwise, the index says where in the
+// list of children it goes.
+StellarObject &System::AddObject(const StellarObject &prototype, int parent, int index)
+{
+    int id = nextId++;
+    StellarObject &object = objects[id] = prototype;
+    object.id = id;
+    object.parent = Object(parent) ? parent : -1;
+    object.children.clear();
+
+    vector<int> &siblings = (object.parent >= 0 ? objects[parent].children : roots);
+    siblings.insert((index < 0) ? siblings.end() : siblings.begin() + index, id);
+
+    order.isValid = false;
+    OrbitsChanged();
+    return object;
+}
+
+
+
+// Remove the given object, and everything that orbits it.
+void System::Erase(int id)
+{
+    StellarObject *object = Object(id);
+    if(!object)
+        return;
+
+    while(!object->children.empty())
+        Erase(object->children.back());
+
+    vector<int> &siblings = (object->parent >= 0 ? objects[object->parent].children : roots);
+    siblings.erase(find(siblings.begin(), siblings.end(), id));
+    objects.erase(id);
+
+    order.isValid = false;
+    OrbitsChanged();
+}
+
+
+
+// Check if the given object belongs to this system.
+bool System::Owns(const StellarObject *object) const
+{
+    return object && Object(object->id) == object;
+}
+
+
+
+// Get the object orbiting the system center that the given object is part of.
+StellarObject *System::Root(StellarObject *object)
+{
+    while(object->parent >= 0)
+        object = Object(object->parent);
+    return object;
+}
+
+
+
+// Get the list of objects that orbit the same thing as the given object,
+// including that object itself.
+const vector<int> &System::Siblings(const StellarObject &object) const
+{
+    return (object.parent >= 0) ? Object(object.parent)->children : roots;
+}
+
+
+
+// Get the object that comes after the given one and everything orbiting it,
+// i.e. the next moon out, or the next planet out if there are no more moons.
+StellarObject *System::Next(const StellarObject &object)
+{
+    const vector<int> &siblings = Siblings(object);
+    auto it = find(siblings.begin(), siblings.end(), object.id) + 1;
+    if(it != siblings.end())
+        return Object(*it);
+    return (object.parent >= 0) ? Next(*Object(object.parent)) : nullptr;
+}
+
+
+
+// Rebuild the list of objects in order, if anything has been added or
+// removed since it was last built. Each object is followed by the objects
+// that orbit it, which is also the order they are saved in.
+void System::UpdateOrder() const
+{
+    if(order.isValid)
+        return;
+
+    order.objects.clear();
+    order.constObjects.clear();
+    vector<int> stack(roots.rbegin(), roots.rend());
+    while(!stack.empty())
+    {
+        // This cache is only ever handed out as const from a const system.
+        StellarObject *object = const_cast<StellarObject *>(Object(stack.back()));
+        stack.pop_back();
+        order.objects.push_back(object);
+        order.constObjects.push_back(object);
+        stack.insert(stack.end(), object->children.rbegin(), object->children.rend());
+    }
+    order.isValid = true;
+}
+
+
+
+// Mark the cached orbital elements as out of date.
+void System::OrbitsChanged()
+{
+    orbitsChanged = true;
+    orbitRevision = ++lastOrbitRevision;
 }
 
 
@@ -919,7 +1199,30 @@ void System::Recompute(StellarObject &object, bool updateOffset)
 set<QString> System::Used() const
 {
     set<QString> used;
-    for(const StellarObject &object : objects)
-        used.insert(object.Sprite());
+    for(const auto &it : objects)
+        used.insert(it.second.Sprite());
     return used;
 }
+
+
+
+// Check if the generated stars and planets satisfy the constraints given
+// to Randomize().
+bool System::IsAcceptable(bool allowHabitable, bool requireHabitable) const
+{
+    bool isInhabited = false;
+    bool isHabitable = false;
+    for(const auto &it : objects)
+    {
+        const StellarObject &object = it.second;
+        isInhabited |= object.IsInhabited();
+        double d = object.Distance();
+        isHabitable |= object.Parent() < 0 && object.IsTerrestrial()
+            && d > .5 * habitable && d < 2. * habitable;
+    }
+    if(isInhabited && !allowHabitable)
+        return false;
+    if(!isHabitable && requireHabitable)
+        return false;
+    return true;
+}
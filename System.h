@@ -13,6 +13,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #ifndef SYSTEM_H_
 #define SYSTEM_H_
 
+#include "OrbitBatch.h"
 #include "StellarObject.h"
 
 #include <QVector2D>
@@ -24,7 +25,9 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 class DataNode;
 class DataWriter;
+class Ephemeris;
 class Planet;
+class Random;
 
 
 
@@ -62,9 +65,16 @@ public:
     // Get a list of systems you can travel to through hyperspace from here.
     const std::set<QString> &Links() const;
 
-    // Get the stellar object locations on the most recently set date.
-    std::vector<StellarObject> &Objects();
-    const std::vector<StellarObject> &Objects() const;
+    // Get the stellar objects, ordered so that each object comes after the
+    // object it orbits. The pointers stay valid until that object is deleted.
+    // The order is rebuilt by the first call after the system is copied or an
+    // object is added or removed, even if the system is const, so that call
+    // must not happen while other threads are reading the same system.
+    const std::vector<StellarObject *> &Objects();
+    const std::vector<const StellarObject *> &Objects() const;
+    // Find the object with the given ID, or return nullptr if there is none.
+    StellarObject *Object(int id);
+    const StellarObject *Object(int id) const;
     // Get the habitable zone's center.
     double HabitableZone() const;
     // Get the radius of the zone occupied by the given stellar object. This
@@ -73,6 +83,10 @@ public:
     double OccupiedRadius(const StellarObject &object) const;
     double OccupiedRadius() const;
     double StarRadius() const;
+    // Get a number that changes whenever any object is added, removed, or put
+    // in a different orbit. Two systems only share a revision if one is a copy
+    // of the other, so their orbits are the same.
+    int OrbitRevision() const;
 
     // Get the specification of how many asteroids of each type there are.
     const std::vector<Asteroid> &Asteroids() const;
@@ -90,9 +104,11 @@ public:
 
     // Position the planets, etc.
     void SetDay(double day);
+    // Position the planets by looking them up in a precomputed table.
+    void SetDay(double day, const Ephemeris &ephemeris);
 
     // Modify the system:
-    void Init(const QString &name, const QVector2D &position);
+    void Init(const QString &name, const QVector2D &position, Random &random);
     void SetName(const QString &name);
     void SetPosition(const QVector2D &pos);
     void SetGovernment(const QString &gov);
@@ -102,22 +118,63 @@ public:
 
     // Editing the stellar objects and their locations:
     void Move(StellarObject *object, double dDistance, double dAngle = 0.);
-    void ChangeAsteroids();
-    void ChangeMinables();
-    void ChangeStar();
-    void ChangeSprite(StellarObject *object);
-    void AddPlanet();
-    void AddMoon(StellarObject *object, bool isStation = false);
-    void Randomize(bool allowHabitable, bool requireHabitable);
+    void ChangeAsteroids(Random &random);
+    void ChangeMinables(Random &random);
+    void ChangeStar(Random &random);
+    void ChangeSprite(StellarObject *object, Random &random);
+    void AddPlanet(Random &random);
+    void AddMoon(StellarObject *object, Random &random, bool isStation = false);
+    // Generate new stars and planets. Many attempts are made in parallel to
+    // find a layout that satisfies the given constraints; the result depends
+    // only on the state of the given random number stream.
+    void Randomize(bool allowHabitable, bool requireHabitable, Random &random);
     void Delete(StellarObject *object);
 
+    // Check that the stellar objects obey the spacing rules that Move()
+    // enforces, and that each one's period matches its distance. A description of
+    // each problem found is added to the given list, in order of the objects they
+    // apply to.
+    void CheckLayout(std::vector<QString> &problems) const;
+
 
 private:
     void LoadObject(const DataNode &node, int parent = -1);
     void SaveObject(DataWriter &file, const StellarObject &object) const;
     void Recompute(StellarObject &object, bool updateOffset = true);
+    // Get the period that an object at its current distance should have.
+    double ExpectedPeriod(const StellarObject &object) const;
     // Get a list of all sprites that are in use already.
     std::set<QString> Used() const;
+    // Check if the generated stars and planets satisfy the constraints given
+    // to Randomize().
+    bool IsAcceptable(bool allowHabitable, bool requireHabitable) const;
+
+    // Editing the hierarchy of stellar objects. Nothing here ever moves an
+    // existing object in memory or changes its ID.
+    StellarObject &AddObject(const StellarObject &prototype, int parent = -1, int index = -1);
+    void Erase(int id);
+    bool Owns(const StellarObject *object) const;
+    StellarObject *Root(StellarObject *object);
+    const std::vector<int> &Siblings(const StellarObject &object) const;
+    StellarObject *Next(const StellarObject &object);
+    void UpdateOrder() const;
+    // Mark the cached orbital elements as out of date.
+    void OrbitsChanged();
+
+
+private:
+    // Cache of the objects in order. A copy of a system must not point into the
+    // original's objects, so copying this just marks it as needing a rebuild.
+    class Order {
+    public:
+        Order() = default;
+        Order(const Order &) {}
+        Order &operator=(const Order &) { isValid = false; return *this; }
+
+        bool isValid = false;
+        std::vector<StellarObject *> objects;
+        std::vector<const StellarObject *> constObjects;
+    };
 
 
 private:
@@ -129,11 +186,18 @@ private:
     // Hyperspace links to other systems.
     std::set<QString> links;
 
-    // Stellar objects, listed in such an order that an object's parents are
-    // guaranteed to appear before it (so that if we traverse the vector in
+    // Stellar objects, by ID. Each object knows its parent's ID and the IDs of
+    // its children, innermost first; the roots are the objects orbiting the
+    // system center, with the stars first. Map nodes never move, so adding or
+    // removing an object never invalidates pointers to any other object.
+    std::map<int, StellarObject> objects;
+    std::vector<int> roots;
+    int nextId = 0;
+    // The objects listed in such an order that an object's parents are
+    // guaranteed to appear before it (so that if we traverse the list in
     // order, updating positions, an object's parents will already be at the
-    // proper position before that object is updated).
-    std::vector<StellarObject> objects;
+    // proper position before that object is updated). This is rebuilt lazily.
+    mutable Order order;
     double habitable;
     QString haze;
     QString music;
@@ -148,6 +212,11 @@ private:
 
     // Keep track of the current time step.
     double timeStep;
+    // Cache of the objects' orbital elements, laid out for batch calculation.
+    // This must be rebuilt whenever any object is added, removed, or moved.
+    OrbitBatch orbits;
+    bool orbitsChanged = true;
+    int orbitRevision = 0;
 };
 
 
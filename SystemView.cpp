@@ -16,6 +16,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include "Map.h"
 #include "pi.h"
 #include "PlanetView.h"
+#include "Random.h"
 #include "SpriteSet.h"
 #include "StellarObject.h"
 #include "System.h"
@@ -24,6 +25,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <QPainterPath>
 #include <QPalette>
 #include <QMouseEvent>
+#include <QSlider>
 #include <QTabWidget>
 #include <QVector2D>
 
@@ -32,6 +34,11 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 
 using namespace std;
 
+namespace {
+    // The last day that can be picked with the timeline slider.
+    static const int MAX_DAY = 100000;
+}
+
 
 
 SystemView::SystemView(Map &mapData, DetailView *detailView, QTabWidget *tabs, QWidget *parent) :
@@ -44,6 +51,13 @@ SystemView::SystemView(Map &mapData, DetailView *detailView, QTabWidget *tabs, Q
 
     connect(&timer, SIGNAL(timeout()), this, SLOT(step()));
     timer.start(1000. / 60.);
+
+    // The timeline slider jumps directly to any day.
+    timeline = new QSlider(Qt::Horizontal, this);
+    timeline->setRange(0, MAX_DAY);
+    timeline->setValue(timeStep);
+    timeline->setToolTip("Drag to scrub through time.");
+    connect(timeline, SIGNAL(valueChanged(int)), this, SLOT(SetDay(int)));
 }
 
 
@@ -56,7 +70,10 @@ void SystemView::Select(System *system)
     this->system = system;
     asteroids.Set(system);
     if(system)
-        system->SetDay(timeStep);
+        ephemeris.Set(*system);
+    else
+        ephemeris.Clear();
+    UpdateDay();
 
     selectedObject = nullptr;
 }
@@ -98,8 +115,7 @@ void SystemView::step()
 
     timeStep += .1;
     asteroids.Step();
-    if(system)
-        system->SetDay(timeStep);
+    UpdateDay();
     update();
 }
 
@@ -109,8 +125,9 @@ void SystemView::RandomizeInhabited()
 {
     if(system)
     {
+        Random random = Random::Operation();
         selectedObject = nullptr;
-        system->Randomize(true, true);
+        system->Randomize(true, true, random);
         DidChange();
     }
 }
@@ -121,8 +138,9 @@ void SystemView::Randomize()
 {
     if(system)
     {
+        Random random = Random::Operation();
         selectedObject = nullptr;
-        system->Randomize(true, false);
+        system->Randomize(true, false, random);
         DidChange();
     }
 }
@@ -133,8 +151,9 @@ void SystemView::RandomizeUninhabited()
 {
     if(system)
     {
+        Random random = Random::Operation();
         selectedObject = nullptr;
-        system->Randomize(false, false);
+        system->Randomize(false, false, random);
         DidChange();
     }
 }
@@ -145,7 +164,8 @@ void SystemView::ChangeAsteroids()
 {
     if(system)
     {
-        system->ChangeAsteroids();
+        Random random = Random::Operation();
+        system->ChangeAsteroids(random);
         asteroids.Set(system);
         DidChange();
     }
@@ -157,7 +177,8 @@ void SystemView::ChangeMinables()
 {
     if(system)
     {
-        system->ChangeMinables();
+        Random random = Random::Operation();
+        system->ChangeMinables(random);
         asteroids.Set(system);
         detailView->UpdateMinables();
         DidChange();
@@ -170,8 +191,11 @@ void SystemView::ChangeStar()
 {
     if(system)
     {
-        system->ChangeStar();
-        selectedObject = nullptr;
+        Random random = Random::Operation();
+        // Only the stars are replaced, so anything else can stay selected.
+        if(selectedObject && selectedObject->IsStar())
+            selectedObject = nullptr;
+        system->ChangeStar(random);
         DidChange();
     }
 }
@@ -184,14 +208,16 @@ void SystemView::ChangePlanet()
     if(!system)
         return;
 
+    Random random = Random::Operation();
+
     if(selectedObject && selectedObject->Parent() < 0 && !selectedObject->IsStation())
     {
-        system->ChangeSprite(selectedObject);
+        system->ChangeSprite(selectedObject, random);
         DidChange();
     }
     else if(!selectedObject)
     {
-        system->AddPlanet();
+        system->AddPlanet(random);
         DidChange();
     }
 }
@@ -204,16 +230,16 @@ void SystemView::ChangeMoon()
     if(!system)
         return;
 
+    Random random = Random::Operation();
+
     if(selectedObject && selectedObject->Parent() >= 0 && !selectedObject->IsStation())
     {
-        system->ChangeSprite(selectedObject);
+        system->ChangeSprite(selectedObject, random);
         DidChange();
     }
     else if(selectedObject && selectedObject->Parent() < 0)
     {
-        int index = selectedObject - &system->Objects().front();
-        system->AddMoon(selectedObject);
-        selectedObject = &system->Objects()[index];
+        system->AddMoon(selectedObject, random);
         DidChange();
     }
 }
@@ -226,16 +252,16 @@ void SystemView::ChangeStation()
     if(!system)
         return;
 
+    Random random = Random::Operation();
+
     if(selectedObject && selectedObject->IsStation())
     {
-        system->ChangeSprite(selectedObject);
+        system->ChangeSprite(selectedObject, random);
         DidChange();
     }
     else if(selectedObject && selectedObject->Parent() < 0)
     {
-        int index = selectedObject - &system->Objects().front();
-        system->AddMoon(selectedObject, true);
-        selectedObject = &system->Objects()[index];
+        system->AddMoon(selectedObject, random, true);
         DidChange();
     }
 }
@@ -261,6 +287,24 @@ void SystemView::Pause()
 
 
 
+void SystemView::ToggleTrails()
+{
+    showTrails = !showTrails;
+    update();
+}
+
+
+
+// Jump to the given day, e.g. when the timeline slider is dragged.
+void SystemView::SetDay(int day)
+{
+    timeStep = day;
+    UpdateDay();
+    update();
+}
+
+
+
 // Select a StellarObject and/or set the dragging position.
 void SystemView::mousePressEvent(QMouseEvent *event)
 {
@@ -281,14 +325,14 @@ void SystemView::mousePressEvent(QMouseEvent *event)
 
     QVector2D pos = MapPoint(event->pos());
     // Check if the click was on a StellarObject (e.g. to start dragging it).
-    for(StellarObject &object : system->Objects())
-        if(!object.IsStar() && pos.distanceToPoint(object.Position()) < object.Radius())
+    for(StellarObject *object : system->Objects())
+        if(!object->IsStar() && pos.distanceToPoint(object->Position()) < object->Radius())
         {
             // Correct the click position to the object's initial position.
             dragTime.start();
-            selectedObject = dragObject = &object;
-            clickOff = object.Position() - pos;
-            planetView->SetPlanet(&object);
+            selectedObject = dragObject = object;
+            clickOff = object->Position() - pos;
+            planetView->SetPlanet(object);
             update();
             return;
         }
@@ -307,10 +351,10 @@ void SystemView::mouseDoubleClickEvent(QMouseEvent *event)
 
     QVector2D pos = MapPoint(event->pos());
     // Check if the click was on a StellarObject (i.e. to view its details).
-    for(StellarObject &object : system->Objects())
-        if(!object.IsStar() && pos.distanceToPoint(object.Position()) < object.Radius())
+    for(StellarObject *object : system->Objects())
+        if(!object->IsStar() && pos.distanceToPoint(object->Position()) < object->Radius())
         {
-            planetView->SetPlanet(&object);
+            planetView->SetPlanet(object);
             tabs->setCurrentWidget(planetView);
             return;
         }
@@ -331,7 +375,7 @@ void SystemView::mouseMoveEvent(QMouseEvent *event)
     {
         QVector2D parentPosition;
         if(dragObject->Parent() >= 0)
-            parentPosition = system->Objects()[dragObject->Parent()].Position();
+            parentPosition = system->Object(dragObject->Parent())->Position();
 
         QVector2D oldPosition = dragObject->Position() - parentPosition;
         QVector2D newPosition = MapPoint(event->pos()) + clickOff - parentPosition;
@@ -346,7 +390,8 @@ void SystemView::mouseMoveEvent(QMouseEvent *event)
         double newRadius = newPosition.length();
 
         system->Move(dragObject, newRadius - oldRadius, (newAngle - oldAngle) * TO_DEG);
-        system->SetDay(timeStep);
+        ephemeris.Set(*system);
+        UpdateDay();
         mapData.SetChanged();
     }
     if(isPaused)
@@ -375,6 +420,15 @@ void SystemView::wheelEvent(QWheelEvent *event)
 
 
 
+// Keep the timeline along the bottom edge of the view.
+void SystemView::resizeEvent(QResizeEvent */*event*/)
+{
+    if(timeline)
+        timeline->setGeometry(10, height() - 30, width() - 20, 20);
+}
+
+
+
 void SystemView::paintEvent(QPaintEvent */*event*/)
 {
     if(!system)
@@ -394,16 +448,16 @@ void SystemView::paintEvent(QPaintEvent */*event*/)
     painter.setBrush(occupiedBrush);
     double starRadius = system->StarRadius();
     painter.drawEllipse(QPointF(), starRadius, starRadius);
-    for(const StellarObject &object : system->Objects())
+    for(const StellarObject *object : system->Objects())
     {
-        double radius = system->OccupiedRadius(object);
+        double radius = system->OccupiedRadius(*object);
         if(!radius)
             continue;
 
         QPainterPath outside;
-        outside.addEllipse(QPointF(), object.Distance() + radius, object.Distance() + radius);
+        outside.addEllipse(QPointF(), object->Distance() + radius, object->Distance() + radius);
         QPainterPath inside;
-        outside.addEllipse(QPointF(), object.Distance() - radius, object.Distance() - radius);
+        outside.addEllipse(QPointF(), object->Distance() - radius, object->Distance() - radius);
         QPainterPath ring = outside.subtracted(inside);
 
         painter.drawPath(ring);
@@ -431,29 +485,50 @@ void SystemView::paintEvent(QPaintEvent */*event*/)
         painter.drawEllipse(QPointF(), 2. * radius, 2. * radius);
     }
 
+    // Draw each object's orbit, using the precomputed samples.
+    if(showTrails && ephemeris.Matches(*system))
+    {
+        QPen trailPen(QColor(60, 60, 90));
+        painter.setPen(trailPen);
+        painter.setBrush(Qt::NoBrush);
+        for(unsigned i = 0; i < system->Objects().size(); ++i)
+        {
+            const StellarObject &object = *system->Objects()[i];
+            if(!object.Distance())
+                continue;
+
+            QPointF center;
+            if(object.Parent() >= 0)
+                center = system->Object(object.Parent())->Position().toPointF();
+            painter.translate(center);
+            painter.drawPolyline(ephemeris.Trail(i), ephemeris.TrailSize());
+            painter.translate(-center);
+        }
+    }
+
     // Draw lines linking objects to their parents.
     QBrush brush(QColor(128, 128, 128));
     painter.setBrush(brush);
     QPen pen(QColor(255, 255, 255));
     pen.setWidthF(1.5);
     painter.setPen(pen);
-    for(const StellarObject &object : system->Objects())
+    for(const StellarObject *object : system->Objects())
     {
         QPointF parent;
-        if(object.Parent() >= 0)
-            parent = system->Objects()[object.Parent()].Position().toPointF();
-        painter.drawLine(object.Position().toPointF(), parent);
+        if(object->Parent() >= 0)
+            parent = system->Object(object->Parent())->Position().toPointF();
+        painter.drawLine(object->Position().toPointF(), parent);
     }
 
     QPen blue(QColor(0, 128, 255));
     blue.setWidthF(2.5);
     painter.setPen(blue);
     painter.setBrush(Qt::NoBrush);
-    for(const StellarObject &object : system->Objects())
+    for(const StellarObject *object : system->Objects())
     {
-        QPixmap sprite = SpriteSet::Get(object.Sprite());
-        QVector2D pos = object.Position();
-        double angle = pos.isNull() ? (-2. * PI * timeStep / object.Period()) : atan2(pos.x(), pos.y());
+        QPixmap sprite = SpriteSet::Get(object->Sprite());
+        QVector2D pos = object->Position();
+        double angle = pos.isNull() ? (-2. * PI * timeStep / object->Period()) : atan2(pos.x(), pos.y());
         angle *= TO_DEG;
         angle += 180.;
 
@@ -462,9 +537,9 @@ void SystemView::paintEvent(QPaintEvent */*event*/)
         painter.drawPixmap(QPointF(-.5 * sprite.width(), -.5 * sprite.height()), sprite);
         painter.rotate(angle);
         painter.translate(-pos.toPointF());
-        if(!object.GetPlanet().isEmpty())
+        if(!object->GetPlanet().isEmpty())
         {
-            double radius = object.Radius() + 5.;
+            double radius = object->Radius() + 5.;
             painter.drawEllipse(pos.toPointF(), radius, radius);
         }
     }
@@ -500,7 +575,24 @@ QVector2D SystemView::MapPoint(QPoint pos) const
 // If a method did something, this updates the map, date, and draw window.
 void SystemView::DidChange()
 {
-    system->SetDay(timeStep);
+    ephemeris.Set(*system);
+    UpdateDay();
     mapData.SetChanged();
     update();
 }
+
+
+
+// Position the system's objects for the current day, and move the timeline
+// to match it (unless the user is dragging the timeline).
+void SystemView::UpdateDay()
+{
+    if(system)
+        system->SetDay(timeStep, ephemeris);
+    if(timeline && !timeline->isSliderDown())
+    {
+        timeline->blockSignals(true);
+        timeline->setValue(timeStep);
+        timeline->blockSignals(false);
+    }
+}
@@ -14,6 +14,7 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #define SYSTEMVIEW_H
 
 #include "AsteroidField.h"
+#include "Ephemeris.h"
 
 #include <QWidget>
 
@@ -27,6 +28,7 @@ class PlanetView;
 class StellarObject;
 class System;
 
+class QSlider;
 class QTabWidget;
 
 
@@ -60,12 +62,15 @@ public slots:
     void ChangeStation();
     void DeleteObject();
     void Pause();
+    void ToggleTrails();
+    void SetDay(int day);
 
 protected:
     virtual void mousePressEvent(QMouseEvent *event) override;
     virtual void mouseDoubleClickEvent(QMouseEvent *event) override;
     virtual void mouseMoveEvent(QMouseEvent *event) override;
     virtual void wheelEvent(QWheelEvent *event) override;
+    virtual void resizeEvent(QResizeEvent *event) override;
 
     virtual void paintEvent(QPaintEvent *event) override;
 
@@ -73,6 +78,7 @@ protected:
 private:
     QVector2D MapPoint(QPoint pos) const;
     void DidChange();
+    void UpdateDay();
 
 
 private:
@@ -93,6 +99,11 @@ private:
     QTimer timer;
     double timeStep = 1000.;
     bool isPaused = false;
+    // Precomputed orbits of the current system, for scrubbing through time
+    // and drawing orbit trails.
+    Ephemeris ephemeris;
+    QSlider *timeline = nullptr;
+    bool showTrails = false;
 
     // Dragging:
     QVector2D clickOff;
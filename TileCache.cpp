@@ -0,0 +1,118 @@
+/* TileCache.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "TileCache.h"
+
+using namespace std;
+
+
+
+TileCache::TileCache(int capacity)
+    : capacity(capacity)
+{
+}
+
+
+
+// Get the tile at the given position, for the given zoom level, or null
+// if it has not been drawn.
+const QImage *TileCache::Find(double scale, int x, int y)
+{
+    auto it = index.find(Key{scale, x, y});
+    if(it == index.end())
+        return nullptr;
+
+    // Move this tile to the front of the list.
+    tiles.splice(tiles.begin(), tiles, it->second);
+    return &it->second->image;
+}
+
+
+
+void TileCache::Insert(double scale, int x, int y, const QImage &image)
+{
+    Key key{scale, x, y};
+    auto it = index.find(key);
+    if(it != index.end())
+    {
+        it->second->image = image;
+        tiles.splice(tiles.begin(), tiles, it->second);
+        return;
+    }
+
+    tiles.push_front(Tile{key, image});
+    index[key] = tiles.begin();
+    while(static_cast<int>(tiles.size()) > capacity)
+    {
+        index.erase(tiles.back().key);
+        tiles.pop_back();
+    }
+}
+
+
+
+// Discard every tile at the given zoom level that covers any part of the
+// given area of the map.
+void TileCache::Invalidate(const QRectF &area, double scale)
+{
+    for(auto it = tiles.begin(); it != tiles.end(); )
+    {
+        if(it->key.scale == scale && Area(it->key.scale, it->key.x, it->key.y).intersects(area))
+        {
+            index.erase(it->key);
+            it = tiles.erase(it);
+        }
+        else
+            ++it;
+    }
+}
+
+
+
+void TileCache::Clear()
+{
+    tiles.clear();
+    index.clear();
+}
+
+
+
+// Get every zoom level that has tiles in the cache.
+vector<double> TileCache::Scales() const
+{
+    // The index is sorted by zoom level first.
+    vector<double> scales;
+    for(const auto &it : index)
+        if(scales.empty() || scales.back() != it.first.scale)
+            scales.push_back(it.first.scale);
+    return scales;
+}
+
+
+
+// Get the area of the map that a tile covers.
+QRectF TileCache::Area(double scale, int x, int y)
+{
+    double size = TILE_SIZE / scale;
+    return QRectF(x * size, y * size, size, size);
+}
+
+
+
+bool TileCache::Key::operator<(const Key &other) const
+{
+    if(scale != other.scale)
+        return scale < other.scale;
+    if(x != other.x)
+        return x < other.x;
+    return y < other.y;
+}
@@ -0,0 +1,79 @@
+/* TileCache.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include <QImage>
+#include <QRectF>
+
+#include <list>
+#include <map>
+#include <vector>
+
+
+
+// Class holding pieces of the galaxy map that have already been drawn, so that
+// panning the view only has to copy them to the screen. The map is divided
+// into square tiles of a fixed size in pixels, so the area of the map that each
+// tile covers depends on the zoom level. Each tile is identified by the zoom
+// level and by its column and row. When the cache is full, the tile that was
+// used least recently is discarded.
+class TileCache {
+public:
+    // The width and height of each tile, in pixels.
+    static const int TILE_SIZE = 256;
+
+
+public:
+    explicit TileCache(int capacity = 192);
+
+    // Get the tile at the given position, for the given zoom level, or null
+    // if it has not been drawn.
+    const QImage *Find(double scale, int x, int y);
+    void Insert(double scale, int x, int y, const QImage &image);
+
+    // Discard every tile at the given zoom level that covers any part of the
+    // given area of the map.
+    void Invalidate(const QRectF &area, double scale);
+    void Clear();
+    // Get every zoom level that has tiles in the cache.
+    std::vector<double> Scales() const;
+
+    // Get the area of the map that a tile covers.
+    static QRectF Area(double scale, int x, int y);
+
+
+private:
+    struct Key {
+        double scale;
+        int x;
+        int y;
+
+        bool operator<(const Key &other) const;
+    };
+    struct Tile {
+        Key key;
+        QImage image;
+    };
+
+
+private:
+    int capacity;
+    // The most recently used tile is at the front.
+    std::list<Tile> tiles;
+    std::map<Key, std::list<Tile>::iterator> index;
+};
+
+
+
+#endif // TILECACHE_H
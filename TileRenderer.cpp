@@ -0,0 +1,77 @@
+/* TileRenderer.cpp
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#include "TileRenderer.h"
+
+#include "GalaxyRenderer.h"
+#include "TileCache.h"
+
+#include <QPainter>
+#include <QtConcurrent>
+
+using namespace std;
+
+
+
+TileRenderer::TileRenderer(GalaxyRenderer &renderer)
+    : renderer(renderer)
+{
+}
+
+
+
+// Draw the given tiles at the given zoom level, and wait for all of them to
+// be done. The tiles are the same size as the ones in a TileCache.
+void TileRenderer::Render(vector<Tile> &tiles, double scale)
+{
+    // A single tile is not worth handing off to another thread.
+    if(tiles.size() == 1)
+    {
+        renderer.Prepare(scale);
+        tiles.front().image = Render(tiles.front().x, tiles.front().y, scale);
+        return;
+    }
+    Start(tiles, scale).waitForFinished();
+}
+
+
+
+// Start drawing the given tiles, and return right away. The tiles must not
+// be touched until the returned future is finished.
+QFuture<void> TileRenderer::Start(vector<Tile> &tiles, double scale)
+{
+    // Anything the renderer would otherwise do the first time it draws must
+    // be done now, before several threads are using it at once.
+    renderer.Prepare(scale);
+    return QtConcurrent::map(tiles, [this, scale](Tile &tile)
+    {
+        tile.image = Render(tile.x, tile.y, scale);
+    });
+}
+
+
+
+// Draw a single tile, in this thread.
+QImage TileRenderer::Render(int x, int y, double scale) const
+{
+    const int size = TileCache::TILE_SIZE;
+    QImage image(size, size, QImage::Format_RGB32);
+    image.fill(Qt::black);
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter.translate(-x * size, -y * size);
+    painter.scale(scale, scale);
+    renderer.Draw(painter, TileCache::Area(scale, x, y), scale);
+    return image;
+}
@@ -0,0 +1,60 @@
+/* TileRenderer.h
+Copyright (c) 2015 by Michael Zahniser
+
+Endless Sky is free software: you can redistribute it and/or modify it under the
+terms of the GNU General Public License as published by the Free Software
+Foundation, either version 3 of the License, or (at your option) any later version.
+
+Endless Sky is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+*/
+
+#ifndef TILERENDERER_H
+#define TILERENDERER_H
+
+#include <QFuture>
+#include <QImage>
+
+#include <vector>
+
+class GalaxyRenderer;
+
+
+
+// Class for drawing many square tiles of the galaxy map at once, using a pool
+// of threads. Each tile is drawn into its own image, with its own painter, and
+// the caller can then copy the images to the screen or write them to a file.
+// Nothing about the map may change while the tiles are being drawn.
+class TileRenderer {
+public:
+    struct Tile {
+        // The column and row of this tile. Tile (0, 0) has its top left corner
+        // at map coordinate (0, 0).
+        int x = 0;
+        int y = 0;
+        QImage image;
+    };
+
+
+public:
+    explicit TileRenderer(GalaxyRenderer &renderer);
+
+    // Draw the given tiles at the given zoom level, and wait for all of them to
+    // be done. The tiles are the same size as the ones in a TileCache.
+    void Render(std::vector<Tile> &tiles, double scale);
+    // Start drawing the given tiles, and return right away. The tiles must not
+    // be touched until the returned future is finished.
+    QFuture<void> Start(std::vector<Tile> &tiles, double scale);
+
+    // Draw a single tile, in this thread.
+    QImage Render(int x, int y, double scale) const;
+
+
+private:
+    GalaxyRenderer &renderer;
+};
+
+
+
+#endif // TILERENDERER_H
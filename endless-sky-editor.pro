@@ -6,11 +6,12 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 TARGET = endless-sky-editor
 TEMPLATE = app
 CONFIG += c++11
+LIBS += -lz
 
 target.path = /usr/games/
 INSTALLS += target
@@ -33,6 +34,8 @@ macx {
 }
 
 SOURCES += main.cpp\
+    BatchGenerator.cpp\
+    CommodityRandomizer.cpp\
     DataFile.cpp\
     DataNode.cpp\
     DataWriter.cpp\
@@ -43,15 +46,33 @@ SOURCES += main.cpp\
     SystemView.cpp \
     Map.cpp \
     SpriteSet.cpp \
+    SpatialIndex.cpp \
     GalaxyView.cpp \
+    JumpDistances.cpp \
     Galaxy.cpp \
+    GalaxyRenderer.cpp \
     DetailView.cpp \
+    Ephemeris.cpp \
     AsteroidField.cpp \
     PlanetView.cpp \
     LandscapeView.cpp \
-    LandscapeLoader.cpp
+    LandscapeLoader.cpp \
+    LayoutRelaxer.cpp \
+    LayoutValidator.cpp \
+    LinkAnalysis.cpp \
+    LinkGenerator.cpp \
+    LinkGraph.cpp \
+    OrbitBatch.cpp \
+    PriceSmoother.cpp \
+    Random.cpp \
+    TileCache.cpp \
+    TileRenderer.cpp \
+    GalaxyExporter.cpp \
+    PngWriter.cpp
 
-HEADERS  += DataFile.h\
+HEADERS  += BatchGenerator.h\
+    CommodityRandomizer.h\
+    DataFile.h\
     DataNode.h\
     DataWriter.h\
     MainWindow.h\
@@ -61,11 +82,27 @@ HEADERS  += DataFile.h\
     SystemView.h \
     Map.h \
     SpriteSet.h \
+    SpatialIndex.h \
     GalaxyView.h \
+    JumpDistances.h \
     Galaxy.h \
+    GalaxyRenderer.h \
     DetailView.h \
+    Ephemeris.h \
     AsteroidField.h \
     PlanetView.h \
     LandscapeView.h \
     LandscapeLoader.h \
-    pi.h
+    LayoutRelaxer.h \
+    LayoutValidator.h \
+    LinkAnalysis.h \
+    LinkGenerator.h \
+    LinkGraph.h \
+    OrbitBatch.h \
+    pi.h \
+    PriceSmoother.h \
+    Random.h \
+    TileCache.h \
+    TileRenderer.h \
+    GalaxyExporter.h \
+    PngWriter.h
@@ -10,6 +10,7 @@ WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
 PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 */
 
+#include "GalaxyExporter.h"
 #include "MainWindow.h"
 #include "Map.h"
 #include "SpriteSet.h"
@@ -17,7 +18,9 @@ PARTICULAR PURPOSE.  See the GNU General Public License for more details.
 #include <QApplication>
 #include <QFileInfo>
 #include <QFileOpenEvent>
+#include <QGuiApplication>
 #include <QString>
+#include <QStringList>
 
 #include <iostream>
 
@@ -45,20 +48,63 @@ public:
 
 void PrintHelp();
 void PrintVersion();
+int RenderGalaxy(int &argc, char *argv[], const QString &mapPath, const QString &imagePath, const GalaxyExporter::Options &options);
 
 
 
 int main(int argc, char *argv[])
 {
     QString path;
+    QString imagePath;
+    GalaxyExporter::Options options;
     for(int i = 1; i < argc; ++i)
     {
         QString arg = argv[i];
+        // All the options for rendering the galaxy take a value.
+        bool isRenderOption = (arg == "--render-galaxy" || arg == "--scale" || arg == "--bounds"
+            || arg == "--commodity" || arg == "--government");
         if(arg == "-v" || arg == "--version")
         {
             PrintVersion();
             return 0;
         }
+        else if(isRenderOption && i + 1 >= argc)
+        {
+            cerr << "Missing value for " << arg.toStdString() << endl;
+            PrintHelp();
+            return 1;
+        }
+        else if(isRenderOption)
+        {
+            QString value = argv[++i];
+            bool isValid = true;
+            if(arg == "--render-galaxy")
+                imagePath = value;
+            else if(arg == "--scale")
+                options.scale = value.toDouble(&isValid);
+            else if(arg == "--bounds")
+            {
+                QStringList edges = value.split(',');
+                double edge[4];
+                isValid = (edges.size() == 4);
+                for(int j = 0; isValid && j < 4; ++j)
+                    edge[j] = edges[j].trimmed().toDouble(&isValid);
+                if(isValid)
+                    options.bounds = QRectF(QPointF(edge[0], edge[1]), QPointF(edge[2], edge[3]));
+            }
+            else if(arg == "--commodity")
+                options.commodity = value;
+            else
+                options.government = value;
+            if(!isValid)
+            {
+                cerr << "Invalid value for " << arg.toStdString() << ": " << value.toStdString() << endl;
+                PrintHelp();
+                return 1;
+            }
+        }
+        else if(arg == "--no-names")
+            options.showNames = false;
         else if(arg[0] != '-')
             path = arg;
         else
@@ -82,6 +128,8 @@ int main(int argc, char *argv[])
 #if defined _WIN32
     path.replace('\\', '/');
 #endif
+    if(!imagePath.isEmpty())
+        return RenderGalaxy(argc, argv, path, imagePath, options);
 
     QApplication app(argc, argv);
     Map mapData;
@@ -104,6 +152,14 @@ void PrintHelp()
     cerr << "    -v, --version: print version information." << endl;
     cerr << "    <path to map.txt>: load the given map file." << endl;
     cerr << "        Sprites are then loaded from ../images/ relative to the map file." << endl;
+    cerr << "    --render-galaxy <path to image.png>: save a picture of the galaxy map" << endl;
+    cerr << "        and exit, without opening a window. This can be combined with:" << endl;
+    cerr << "    --scale <pixels>: pixels per unit of map distance (default 1)." << endl;
+    cerr << "    --bounds <left,top,right,bottom>: the area of the map to draw" << endl;
+    cerr << "        (default: every system, plus a margin)." << endl;
+    cerr << "    --commodity <name>: color the systems by this commodity's price." << endl;
+    cerr << "    --government <name>: color the systems by government." << endl;
+    cerr << "    --no-names: do not draw the names of the systems." << endl;
     cerr << endl;
     cerr << "Report bugs to: mzahniser@gmail.com" << endl;
     cerr << "Home page: <https://endless-sky.github.io>" << endl;
@@ -121,3 +177,30 @@ void PrintVersion()
     cerr << "There is NO WARRANTY, to the extent permitted by law." << endl;
     cerr << endl;
 }
+
+
+
+// Save a picture of the galaxy map without opening any windows. Unless some
+// other platform is asked for, this does not even need a display.
+int RenderGalaxy(int &argc, char *argv[], const QString &mapPath, const QString &imagePath, const GalaxyExporter::Options &options)
+{
+    if(mapPath.isEmpty())
+    {
+        cerr << "No map file to render." << endl;
+        return 1;
+    }
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    Map mapData;
+    mapData.Load(mapPath);
+
+    QString error;
+    if(!GalaxyExporter::Export(mapData, imagePath, options, &error))
+    {
+        cerr << error.toStdString() << endl;
+        return 1;
+    }
+    return 0;
+}